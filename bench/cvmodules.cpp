@@ -0,0 +1,565 @@
+//-----------------------------------------------------------------------------
+// Measures the cost of every CVModule class in ns/sample across sample rates
+// and block sizes and prints it as CSV or JSON, see doc/benchmarks.md
+//-----------------------------------------------------------------------------
+
+#include "../include/cvmodules.h"
+#include "../include/patchgraph.h"
+#include "../include/simdlanes.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace Steinberg;
+using namespace Steinberg::Synth;
+
+namespace {
+
+const char* TIER_NAMES[kNumSineQualities] = { "Table", "Polynomial", "Exact" };
+
+//-----------------------------------------------------------------------------
+/** An input that costs as little as possible, so a module fed by it is
+    measured without the cost of a real source */
+class ConstantSource : public CVModule
+{
+    float value;
+public:
+    ConstantSource(float _value) : value(_value) {}
+    virtual float output() { return value; }
+    virtual void process(float* out, int32 numSamples) {
+        std::fill(out, out + numSamples, value);
+    }
+};
+
+//-----------------------------------------------------------------------------
+/** Plays one period of a sine over and over, a cheap but changing modulator */
+class TableSource : public CVModule
+{
+    std::vector<float> table;
+    size_t position;
+public:
+    TableSource() : table(997), position(0) {
+        for (size_t i = 0; i < table.size(); i++) {
+            table[i] = (float) (2 * std::sin(2 * M_PI * i / table.size()));
+        }
+    }
+    virtual float output() {
+        float value = table[position];
+        position = (position + 1) % table.size();
+        return value;
+    }
+    virtual void process(float* out, int32 numSamples) {
+        for (int32 i = 0; i < numSamples; i++) {
+            out[i] = table[position];
+            position = position + 1 == table.size() ? 0 : position + 1;
+        }
+    }
+};
+
+//-----------------------------------------------------------------------------
+/** One module under test together with the sources it needs */
+class ModuleBench
+{
+public:
+    virtual ~ModuleBench() {}
+    virtual void setup(Vst::SampleRate* sampleRate, int32 blockSize)=0;
+    virtual void render(float* out, int32 numSamples)=0;
+    /** Called before every block, the envelopes are pressed and released here */
+    virtual void advance(int64 position) { return; }
+};
+
+//-----------------------------------------------------------------------------
+/** Presses a module at the start of every quarter second and releases it
+    after 60% of it, so every stage of an envelope is part of the measurement */
+class TriggerCycle
+{
+    int64 length;
+    int64 releaseAt;
+    int32 blockSize;
+public:
+    TriggerCycle() : length(1), releaseAt(1), blockSize(1) {}
+    void setup(Vst::SampleRate sampleRate, int32 _blockSize) {
+        length = (int64) (sampleRate / 4);
+        releaseAt = length * 6 / 10;
+        blockSize = _blockSize;
+    }
+    //the events are applied at block boundaries
+    template <class T>
+    void advance(int64 position, T& module) {
+        int64 inCycle = position % length;
+        if (inCycle < blockSize) {
+            module.press();
+        }
+        else if (inCycle >= releaseAt && inCycle - blockSize < releaseAt) {
+            module.release();
+        }
+    }
+};
+
+//-----------------------------------------------------------------------------
+class CamertoneBench : public ModuleBench
+{
+    Camertone osc;
+public:
+    virtual void setup(Vst::SampleRate* sampleRate, int32 blockSize) {
+        osc.setSampleRate(sampleRate);
+        osc.setBlockSize(blockSize);
+    }
+    virtual void render(float* out, int32 numSamples) { osc.process(out, numSamples); }
+};
+
+//-----------------------------------------------------------------------------
+class OscillatorBench : public ModuleBench
+{
+    Oscillator osc;
+public:
+    virtual void setup(Vst::SampleRate* sampleRate, int32 blockSize) {
+        osc.setSampleRate(sampleRate);
+        osc.setBlockSize(blockSize);
+    }
+    virtual void render(float* out, int32 numSamples) { osc.process(out, numSamples); }
+};
+
+//-----------------------------------------------------------------------------
+/** An oscillator whose frequency is automated across every block,
+    this is the cost of the sweep path */
+class OscillatorSweepBench : public ModuleBench
+{
+    Oscillator osc;
+    bool up;
+public:
+    OscillatorSweepBench() : up(false) {}
+    virtual void setup(Vst::SampleRate* sampleRate, int32 blockSize) {
+        osc.setSampleRate(sampleRate);
+        osc.setBlockSize(blockSize);
+    }
+    virtual void advance(int64 position) {
+        Vst::ParamValue freq = up ? 880 : 440;
+        osc.rampFrequency(&freq, 1 << 20);
+        up = !up;
+    }
+    virtual void render(float* out, int32 numSamples) { osc.process(out, numSamples); }
+};
+
+//-----------------------------------------------------------------------------
+class FMOscBench : public ModuleBench
+{
+    FMOsc osc;
+    TableSource modulator;
+public:
+    FMOscBench() { osc.setModulator(&modulator); }
+    virtual void setup(Vst::SampleRate* sampleRate, int32 blockSize) {
+        osc.setSampleRate(sampleRate);
+        osc.setBlockSize(blockSize);
+    }
+    virtual void render(float* out, int32 numSamples) { osc.process(out, numSamples); }
+};
+
+//-----------------------------------------------------------------------------
+class LinearADSRBench : public ModuleBench
+{
+    LinearADSR envelope;
+    TriggerCycle cycle;
+public:
+    virtual void setup(Vst::SampleRate* sampleRate, int32 blockSize) {
+        envelope.setSampleRate(sampleRate);
+        envelope.setBlockSize(blockSize);
+        Vst::ParamValue value = 0.01;
+        envelope.setAttack(&value);
+        value = 0.05;
+        envelope.setDecay(&value);
+        envelope.setRelease(&value);
+        value = 0.5;
+        envelope.setSustain(&value);
+        cycle.setup(*sampleRate, blockSize);
+    }
+    virtual void advance(int64 position) { cycle.advance(position, envelope); }
+    virtual void render(float* out, int32 numSamples) { envelope.process(out, numSamples); }
+};
+
+//-----------------------------------------------------------------------------
+class ExponentialADSRBench : public ModuleBench
+{
+    ExponentialADSR envelope;
+    TriggerCycle cycle;
+public:
+    virtual void setup(Vst::SampleRate* sampleRate, int32 blockSize) {
+        envelope.setSampleRate(sampleRate);
+        envelope.setBlockSize(blockSize);
+        Vst::ParamValue value = 0.01;
+        envelope.setAttack(&value);
+        value = 0.05;
+        envelope.setDecay(&value);
+        envelope.setRelease(&value);
+        value = 0.5;
+        envelope.setSustain(&value);
+        cycle.setup(*sampleRate, blockSize);
+    }
+    virtual void advance(int64 position) { cycle.advance(position, envelope); }
+    virtual void render(float* out, int32 numSamples) { envelope.process(out, numSamples); }
+};
+
+//-----------------------------------------------------------------------------
+class SmoothGateBench : public ModuleBench
+{
+    SmoothGate gate;
+    TriggerCycle cycle;
+public:
+    virtual void setup(Vst::SampleRate* sampleRate, int32 blockSize) {
+        gate.setSampleRate(sampleRate);
+        gate.setBlockSize(blockSize);
+        cycle.setup(*sampleRate, blockSize);
+    }
+    virtual void advance(int64 position) { cycle.advance(position, gate); }
+    virtual void render(float* out, int32 numSamples) { gate.process(out, numSamples); }
+};
+
+//-----------------------------------------------------------------------------
+class MixerBench : public ModuleBench
+{
+    Mixer mixer;
+    std::vector<ConstantSource> sources;
+public:
+    MixerBench(int32 numInputs) {
+        sources.reserve(numInputs);
+        for (int32 i = 0; i < numInputs; i++) {
+            sources.emplace_back(0.1f * (i + 1));
+        }
+        for (size_t i = 0; i < sources.size(); i++) {
+            mixer.addInput(&sources[i]);
+        }
+    }
+    virtual void setup(Vst::SampleRate* sampleRate, int32 blockSize) {
+        mixer.setSampleRate(sampleRate);
+        mixer.setBlockSize(blockSize);
+    }
+    virtual void render(float* out, int32 numSamples) { mixer.process(out, numSamples); }
+};
+
+//-----------------------------------------------------------------------------
+class ModAmpBench : public ModuleBench
+{
+    ModAmp amp;
+    TableSource input;
+    ConstantSource modulator;
+public:
+    ModAmpBench() : modulator(0.5f) {
+        amp.setInput(&input);
+        amp.setModulator(&modulator);
+    }
+    virtual void setup(Vst::SampleRate* sampleRate, int32 blockSize) {
+        amp.setSampleRate(sampleRate);
+        amp.setBlockSize(blockSize);
+    }
+    virtual void render(float* out, int32 numSamples) { amp.process(out, numSamples); }
+};
+
+//-----------------------------------------------------------------------------
+/** Two operators, the first one modulating the second one, like algorithm 1,
+    rendered in blocks or sample by sample with output() */
+class FMOperatorPairBench : public ModuleBench
+{
+    FMOperator op1;
+    FMOperator op2;
+    bool perSample;
+    TriggerCycle cycle;
+
+    struct Envelopes
+    {
+        FMOperator* op1;
+        FMOperator* op2;
+        void press() {
+            op1->getEnvelopeAddress()->press();
+            op2->getEnvelopeAddress()->press();
+        }
+        void release() {
+            op1->getEnvelopeAddress()->release();
+            op2->getEnvelopeAddress()->release();
+        }
+    } envelopes;
+public:
+    FMOperatorPairBench(bool _perSample) : perSample(_perSample) {
+        op2.addModulator(&op1);
+        envelopes.op1 = &op1;
+        envelopes.op2 = &op2;
+    }
+    virtual void setup(Vst::SampleRate* sampleRate, int32 blockSize) {
+        op1.setSampleRate(sampleRate);
+        op2.setSampleRate(sampleRate);
+        op1.setBlockSize(blockSize);
+        op2.setBlockSize(blockSize);
+        Vst::ParamValue value = 0.05;
+        op1.setDecay(&value);
+        op2.setDecay(&value);
+        op1.setRelease(&value);
+        op2.setRelease(&value);
+        value = 0.7;
+        op1.setSustain(&value);
+        op2.setSustain(&value);
+        cycle.setup(*sampleRate, blockSize);
+    }
+    virtual void advance(int64 position) { cycle.advance(position, envelopes); }
+    virtual void render(float* out, int32 numSamples) {
+        if (!perSample) {
+            op2.process(out, numSamples);
+            return;
+        }
+        for (int32 i = 0; i < numSamples; i++) {
+            out[i] = op2.output();
+        }
+    }
+};
+
+//-----------------------------------------------------------------------------
+/** One operator modulating two carriers that are mixed, pulled from the mixer
+    or rendered by a PatchGraph, which renders the shared modulator once */
+class FanOutBench : public ModuleBench
+{
+    static const int32 NUM_OPERATORS = 3;
+    FMOperator ops[NUM_OPERATORS];
+    Mixer mixer;
+    PatchGraph graph;
+    bool compiled;
+    TriggerCycle cycle;
+
+    struct Envelopes
+    {
+        FMOperator* ops;
+        void press() {
+            for (int32 i = 0; i < NUM_OPERATORS; i++) {
+                ops[i].getEnvelopeAddress()->press();
+            }
+        }
+        void release() {
+            for (int32 i = 0; i < NUM_OPERATORS; i++) {
+                ops[i].getEnvelopeAddress()->release();
+            }
+        }
+    } envelopes;
+public:
+    FanOutBench(bool _compiled) : compiled(_compiled) {
+        ops[1].addModulator(&ops[0]);
+        ops[2].addModulator(&ops[0]);
+        mixer.addInput(&ops[1]);
+        mixer.addInput(&ops[2]);
+        envelopes.ops = ops;
+    }
+    virtual void setup(Vst::SampleRate* sampleRate, int32 blockSize) {
+        mixer.setSampleRate(sampleRate);
+        mixer.setBlockSize(blockSize);
+        for (int32 i = 0; i < NUM_OPERATORS; i++) {
+            ops[i].setSampleRate(sampleRate);
+            ops[i].setBlockSize(blockSize);
+        }
+        if (compiled) {
+            graph.compile(&mixer, blockSize);
+        }
+        cycle.setup(*sampleRate, blockSize);
+    }
+    virtual void advance(int64 position) { cycle.advance(position, envelopes); }
+    virtual void render(float* out, int32 numSamples) {
+        if (compiled) {
+            graph.process(out, numSamples);
+        }
+        else {
+            mixer.process(out, numSamples);
+        }
+    }
+};
+
+//-----------------------------------------------------------------------------
+struct BenchEntry
+{
+    const char* name;
+    ModuleBench* (*create)();
+};
+
+const BenchEntry BENCHES[] = {
+    { "Camertone",      []() -> ModuleBench* { return new CamertoneBench(); } },
+    { "Oscillator",     []() -> ModuleBench* { return new OscillatorBench(); } },
+    { "Oscillator/sweep", []() -> ModuleBench* { return new OscillatorSweepBench(); } },
+    { "FMOsc",          []() -> ModuleBench* { return new FMOscBench(); } },
+    { "LinearADSR",     []() -> ModuleBench* { return new LinearADSRBench(); } },
+    { "ExponentialADSR", []() -> ModuleBench* { return new ExponentialADSRBench(); } },
+    { "SmoothGate",     []() -> ModuleBench* { return new SmoothGateBench(); } },
+    { "Mixer/1",        []() -> ModuleBench* { return new MixerBench(1); } },
+    { "Mixer/2",        []() -> ModuleBench* { return new MixerBench(2); } },
+    { "Mixer/4",        []() -> ModuleBench* { return new MixerBench(4); } },
+    { "Mixer/8",        []() -> ModuleBench* { return new MixerBench(8); } },
+    { "ModAmp",         []() -> ModuleBench* { return new ModAmpBench(); } },
+    { "FMOperator/pair", []() -> ModuleBench* { return new FMOperatorPairBench(false); } },
+    { "FMOperator/pair/sample", []() -> ModuleBench* { return new FMOperatorPairBench(true); } },
+    { "FanOut/pull",    []() -> ModuleBench* { return new FanOutBench(false); } },
+    { "FanOut/graph",   []() -> ModuleBench* { return new FanOutBench(true); } },
+};
+const int32 NUM_BENCHES = sizeof(BENCHES) / sizeof(BENCHES[0]);
+
+struct Result
+{
+    const char* name;
+    double sampleRate;
+    int32 blockSize;
+    double median;      //ns/sample
+    double best;        //ns/sample
+};
+
+//-----------------------------------------------------------------------------
+/** Renders the given number of seconds block by block and returns the time
+    per sample of every repetition, the first (warm-up) run is not counted */
+std::vector<double> measure(const BenchEntry& entry, Vst::SampleRate sampleRate,
+                            int32 blockSize, double seconds, int32 repeats) {
+    ModuleBench* bench = entry.create();
+    bench->setup(&sampleRate, blockSize);
+
+    const int64 numSamples = std::max((int64) (seconds * sampleRate), (int64) blockSize);
+    std::vector<float> out(blockSize);
+    std::vector<double> times;
+    float sink = 0;
+    int64 position = 0;
+
+    for (int32 r = 0; r <= repeats; r++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int64 done = 0; done < numSamples; done += blockSize) {
+            bench->advance(position);
+            bench->render(out.data(), blockSize);
+            sink += out[blockSize - 1];
+            position += blockSize;
+        }
+        auto end = std::chrono::steady_clock::now();
+        if (r > 0) {
+            int64 rendered = (numSamples + blockSize - 1) / blockSize * blockSize;
+            times.push_back(std::chrono::duration<double, std::nano>(end - start).count() / rendered);
+        }
+    }
+
+    if (sink == 12345.f) {
+        std::printf(" ");   //keeps the loop from being optimized away
+    }
+    delete bench;
+    return times;
+}
+
+//-----------------------------------------------------------------------------
+/** Parses a comma separated list of positive integers */
+bool parseList(const char* text, std::vector<int32>& values) {
+    values.clear();
+    const char* p = text;
+    while (std::isdigit((unsigned char) *p)) {
+        char* end;
+        errno = 0;
+        long value = std::strtol(p, &end, 10);
+        if (value <= 0 || value > INT32_MAX || errno == ERANGE) {
+            return false;
+        }
+        values.push_back((int32) value);
+        if (*end == 0) {
+            return true;
+        }
+        if (*end != ',') {
+            return false;
+        }
+        p = end + 1;
+    }
+    return false;
+}
+
+void usage() {
+    std::fprintf(stderr,
+        "usage: CVModuleBench [--format csv|json] [--rates 44100,48000,...]\n"
+        "                     [--blocks 16,64,...] [--seconds s] [--repeats n]\n"
+        "                     [--filter name]\n");
+}
+
+} //namespace
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+    bool json = false;
+    std::vector<int32> rates = { 44100, 48000, 96000, 192000 };
+    std::vector<int32> blocks = { 16, 64, 256, 1024 };
+    double seconds = 0.5;
+    int32 repeats = 5;
+    const char* filter = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+        if (std::strcmp(arg, "--format") == 0 && ok) {
+            json = std::strcmp(value, "json") == 0;
+            ok = json || std::strcmp(value, "csv") == 0;
+        }
+        else if (std::strcmp(arg, "--rates") == 0 && ok) {
+            ok = parseList(value, rates);
+        }
+        else if (std::strcmp(arg, "--blocks") == 0 && ok) {
+            ok = parseList(value, blocks);
+        }
+        else if (std::strcmp(arg, "--seconds") == 0 && ok) {
+            seconds = std::atof(value);
+            ok = seconds > 0;
+        }
+        else if (std::strcmp(arg, "--repeats") == 0 && ok) {
+            repeats = std::atoi(value);
+            ok = repeats > 0;
+        }
+        else if (std::strcmp(arg, "--filter") == 0 && ok) {
+            filter = value;
+        }
+        else {
+            ok = false;
+        }
+        if (!ok) {
+            usage();
+            return 1;
+        }
+        i++;
+    }
+
+    std::vector<Result> results;
+    for (int32 b = 0; b < NUM_BENCHES; b++) {
+        if (filter && std::strstr(BENCHES[b].name, filter) == nullptr) {
+            continue;
+        }
+        for (int32 rate : rates) {
+            for (int32 blockSize : blocks) {
+                std::vector<double> times = measure(BENCHES[b], rate, blockSize, seconds, repeats);
+                std::sort(times.begin(), times.end());
+                Result result = { BENCHES[b].name, (double) rate, blockSize,
+                                  times[times.size() / 2], times.front() };
+                results.push_back(result);
+            }
+        }
+    }
+
+    const char* tier = TIER_NAMES[SYNTH_DEFAULT_SINE_QUALITY];
+    if (json) {
+        std::printf("{\n  \"simd_width\": %d,\n  \"sine_quality\": \"%s\",\n  \"results\": [\n",
+                    (int) simd::WIDTH, tier);
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& r = results[i];
+            std::printf("    {\"module\": \"%s\", \"sample_rate\": %.0f, \"block_size\": %d, "
+                        "\"ns_per_sample\": %.4f, \"best_ns_per_sample\": %.4f}%s\n",
+                        r.name, r.sampleRate, (int) r.blockSize, r.median, r.best,
+                        i + 1 < results.size() ? "," : "");
+        }
+        std::printf("  ]\n}\n");
+        return 0;
+    }
+
+    std::printf("module,sample_rate,block_size,ns_per_sample,best_ns_per_sample,simd_width,sine_quality\n");
+    for (const Result& r : results) {
+        std::printf("%s,%.0f,%d,%.4f,%.4f,%d,%s\n", r.name, r.sampleRate, (int) r.blockSize,
+                    r.median, r.best, (int) simd::WIDTH, tier);
+    }
+    return 0;
+}
@@ -0,0 +1,145 @@
+//-----------------------------------------------------------------------------
+// Measures the error and the cost of every SineQuality tier
+// and prints them as the markdown table used in doc/sine-tiers.md
+//-----------------------------------------------------------------------------
+
+#include "../include/sinekernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace Steinberg;
+using namespace Steinberg::Synth;
+
+namespace {
+
+const double TWO_PI = 6.28318530717958647692;
+const double SAMPLE_RATE = 48000;
+
+const char* TIER_NAMES[kNumSineQualities] = { "Table", "Polynomial", "Exact" };
+
+//-----------------------------------------------------------------------------
+/** The largest difference from the double precision sine over the range of
+    arguments the FM oscillators can produce */
+double maxAbsError(SineQuality quality) {
+    const int32 count = 1 << 20;
+    std::vector<float> x(count);
+    std::vector<float> zero(count, 0.f);
+    std::vector<float> y(count);
+    for (int32 i = 0; i < count; i++) {
+        x[i] = (float) (-8 * TWO_PI + 16 * TWO_PI * i / count);
+    }
+
+    //a zero increment turns the FM kernel into sin(mod[i])
+    Phase phase = 0;
+    fmSineBlock(y.data(), &phase, 0, x.data(), count, quality);
+
+    double error = 0;
+    for (int32 i = 0; i < count; i++) {
+        error = std::max(error, std::fabs(y[i] - std::sin((double) x[i])));
+    }
+    return error;
+}
+
+//-----------------------------------------------------------------------------
+/** Renders 2^16 samples of a tone close to 1 kHz, fits a sinusoid to it and
+    returns the harmonic distortion (harmonics 2 to 10) and the distortion
+    plus noise relative to the fundamental, both in dB */
+void distortion(SineQuality quality, double* thd, double* thdN) {
+    //1365 periods in 2^16 samples: the increment is exact in a Phase, the
+    //tone is not rounded off the frequency of the fit, and every sample of
+    //the window has another phase
+    const int32 count = 1 << 16;
+    const double freq = SAMPLE_RATE * 1365 / count;
+    std::vector<float> y(count);
+
+    Phase phase = 0;
+    sineBlock(y.data(), &phase, cyclesToPhase(freq / SAMPLE_RATE), count, quality);
+
+    //the window holds a whole number of periods, so the bins do not leak
+    auto amplitude = [&](double f, double* re, double* im) {
+        *re = 0;
+        *im = 0;
+        for (int32 i = 0; i < count; i++) {
+            *re += y[i] * std::cos(TWO_PI * f * i / SAMPLE_RATE);
+            *im += y[i] * std::sin(TWO_PI * f * i / SAMPLE_RATE);
+        }
+        *re *= 2.0 / count;
+        *im *= 2.0 / count;
+        return std::sqrt(*re * *re + *im * *im);
+    };
+
+    double re1, im1;
+    double fundamental = amplitude(freq, &re1, &im1);
+
+    double harmonics = 0;
+    for (int32 k = 2; k <= 10; k++) {
+        double re, im;
+        double a = amplitude(k * freq, &re, &im);
+        harmonics += a * a;
+    }
+    *thd = 20 * std::log10(std::sqrt(harmonics) / fundamental);
+
+    double residual = 0;
+    for (int32 i = 0; i < count; i++) {
+        double fit = re1 * std::cos(TWO_PI * freq * i / SAMPLE_RATE)
+                   + im1 * std::sin(TWO_PI * freq * i / SAMPLE_RATE);
+        residual += (y[i] - fit) * (y[i] - fit);
+    }
+    residual = std::sqrt(residual / count);
+    *thdN = 20 * std::log10(residual / (fundamental / std::sqrt(2.0)));
+}
+
+//-----------------------------------------------------------------------------
+/** Nanoseconds per sample of rendering 256-sample blocks */
+double nsPerSample(SineQuality quality, bool fm) {
+    const int32 blockSize = 256;
+    const int32 repeats = 20000;
+    std::vector<float> out(blockSize);
+    std::vector<float> mod(blockSize);
+    for (int32 i = 0; i < blockSize; i++) {
+        mod[i] = (float) (3 * std::sin(TWO_PI * i / blockSize));
+    }
+
+    Phase phase = 0;
+    Phase increment = cyclesToPhase(440 / SAMPLE_RATE);
+    float sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int32 r = 0; r < repeats; r++) {
+        if (fm) {
+            fmSineBlock(out.data(), &phase, increment, mod.data(), blockSize, quality);
+        }
+        else {
+            sineBlock(out.data(), &phase, increment, blockSize, quality);
+        }
+        sink += out[r % blockSize];
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    if (sink == 12345.f) {
+        std::printf(" ");   //keeps the loop from being optimized away
+    }
+    return std::chrono::duration<double, std::nano>(end - start).count() / (blockSize * repeats);
+}
+
+} //namespace
+
+//-----------------------------------------------------------------------------
+int main() {
+    std::printf("| Tier | Max abs error | THD (dB) | THD+N (dB) | ns/sample | ns/sample (FM) |\n");
+    std::printf("|------|---------------|----------|------------|-----------|----------------|\n");
+
+    for (int32 q = 0; q < kNumSineQualities; q++) {
+        SineQuality quality = (SineQuality) q;
+        double thd, thdN;
+        distortion(quality, &thd, &thdN);
+        std::printf("| %s | %.2e | %.1f | %.1f | %.2f | %.2f |\n",
+                    TIER_NAMES[q], maxAbsError(quality), thd, thdN,
+                    nsPerSample(quality, false), nsPerSample(quality, true));
+    }
+    return 0;
+}
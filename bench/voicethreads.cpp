@@ -0,0 +1,216 @@
+//-----------------------------------------------------------------------------
+// Measures FMVoiceBank with all its voices held on 1 .. N render threads and
+// at every oversampling factor, prints ns/sample, the speedup over one thread
+// and the cost relative to no oversampling as CSV, see doc/benchmarks.md
+//-----------------------------------------------------------------------------
+
+#include "../include/simdlanes.h"
+#include "../include/voicebank.h"
+#include "../include/workerpool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace Steinberg;
+using namespace Steinberg::Synth;
+
+namespace {
+
+struct Result
+{
+    int32 oversampling;
+    int32 threads;
+    int32 blockSize;
+    double median;      //ns/sample
+    double best;        //ns/sample
+};
+
+//-----------------------------------------------------------------------------
+/** Renders the given number of seconds with `numVoices` keys held and
+    returns the time per sample of every repetition, the first (warm-up)
+    run is not counted */
+std::vector<double> measure(int32 oversampling, int32 threads, int32 numVoices,
+                            Vst::SampleRate sampleRate, int32 blockSize,
+                            double seconds, int32 repeats, int32 algorithm) {
+    WorkerPool pool;
+    FMVoiceBank bank;
+    bank.setSampleRate(&sampleRate);
+    bank.setBlockSize(blockSize);
+    bank.setOversampling(oversampling);
+    pool.start(threads - 1, PolyKeyboard::MAX_POLYPHONY / simd::WIDTH);
+    bank.setWorkerPool(pool.getNumWorkers() > 0 ? &pool : nullptr);
+
+    Vst::ParamValue sustain = 1;
+    bank.setPolyphony(PolyKeyboard::MAX_POLYPHONY);
+    bank.setAlgorithm(algorithm);
+    for (int32 op = 0; op < FMVoiceBank::NUM_OPERATORS; op++) {
+        bank.setOperatorSustain(op, &sustain);
+    }
+    for (int16 key = 0; key < numVoices; key++) {
+        int16 pitch = 36 + key;
+        bank.keyOn(&pitch);
+    }
+
+    const int64 numSamples = std::max((int64) (seconds * sampleRate), (int64) blockSize);
+    std::vector<float> out(blockSize);
+    std::vector<double> times;
+    float sink = 0;
+
+    for (int32 r = 0; r <= repeats; r++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int64 done = 0; done < numSamples; done += blockSize) {
+            bank.process(out.data(), blockSize);
+            sink += out[blockSize - 1];
+        }
+        auto end = std::chrono::steady_clock::now();
+        if (r > 0) {
+            int64 rendered = (numSamples + blockSize - 1) / blockSize * blockSize;
+            times.push_back(std::chrono::duration<double, std::nano>(end - start).count() / rendered);
+        }
+    }
+
+    if (sink == 12345.f) {
+        std::printf(" ");   //keeps the loop from being optimized away
+    }
+    bank.setWorkerPool(nullptr);
+    pool.stop();
+    return times;
+}
+
+/** The median of the row with the given settings */
+double findMedian(const std::vector<Result>& results, int32 oversampling,
+                  int32 threads, int32 blockSize) {
+    for (const Result& r : results) {
+        if (r.oversampling == oversampling && r.threads == threads && r.blockSize == blockSize) {
+            return r.median;
+        }
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+/** Parses a comma separated list of positive integers */
+bool parseList(const char* text, std::vector<int32>& values) {
+    values.clear();
+    const char* p = text;
+    while (std::isdigit((unsigned char) *p)) {
+        char* end;
+        errno = 0;
+        long value = std::strtol(p, &end, 10);
+        if (value <= 0 || value > INT32_MAX || errno == ERANGE) {
+            return false;
+        }
+        values.push_back((int32) value);
+        if (*end == 0) {
+            return true;
+        }
+        if (*end != ',') {
+            return false;
+        }
+        p = end + 1;
+    }
+    return false;
+}
+
+void usage() {
+    std::fprintf(stderr,
+        "usage: VoiceThreadsBench [--threads n] [--oversampling 1,2,4,8] [--voices n]\n"
+        "                         [--rate r] [--blocks 64,256,...] [--seconds s] [--repeats n]\n"
+        "                         [--algorithm n]\n");
+}
+
+} //namespace
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+    int32 maxThreads = WorkerPool::MAX_THREADS;
+    std::vector<int32> factors = { 1, 2, 4, 8 };
+    int32 numVoices = PolyKeyboard::MAX_POLYPHONY;
+    double rate = 48000;
+    std::vector<int32> blocks = { 64, 256, 1024 };
+    double seconds = 0.5;
+    int32 repeats = 5;
+    int32 algorithm = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+        if (std::strcmp(arg, "--threads") == 0 && ok) {
+            maxThreads = std::atoi(value);
+            ok = maxThreads > 0 && maxThreads <= WorkerPool::MAX_THREADS;
+        }
+        else if (std::strcmp(arg, "--oversampling") == 0 && ok) {
+            ok = parseList(value, factors);
+            for (int32 factor : factors) {
+                ok = ok && (factor == 1 || factor == 2 || factor == 4 || factor == 8);
+            }
+        }
+        else if (std::strcmp(arg, "--voices") == 0 && ok) {
+            numVoices = std::atoi(value);
+            ok = numVoices > 0 && numVoices <= PolyKeyboard::MAX_POLYPHONY;
+        }
+        else if (std::strcmp(arg, "--rate") == 0 && ok) {
+            rate = std::atof(value);
+            ok = rate > 0;
+        }
+        else if (std::strcmp(arg, "--blocks") == 0 && ok) {
+            ok = parseList(value, blocks);
+        }
+        else if (std::strcmp(arg, "--seconds") == 0 && ok) {
+            seconds = std::atof(value);
+            ok = seconds > 0;
+        }
+        else if (std::strcmp(arg, "--repeats") == 0 && ok) {
+            repeats = std::atoi(value);
+            ok = repeats > 0;
+        }
+        else if (std::strcmp(arg, "--algorithm") == 0 && ok) {
+            algorithm = std::atoi(value);
+            ok = algorithm >= 0 && algorithm < kNumFMAlgorithms;
+        }
+        else {
+            ok = false;
+        }
+        if (!ok) {
+            usage();
+            return 1;
+        }
+        i++;
+    }
+
+    std::vector<Result> results;
+    for (int32 blockSize : blocks) {
+        for (int32 factor : factors) {
+            for (int32 threads = 1; threads <= maxThreads; threads++) {
+                std::vector<double> times = measure(factor, threads, numVoices, rate,
+                                                    blockSize, seconds, repeats, algorithm);
+                std::sort(times.begin(), times.end());
+                Result result = { factor, threads, blockSize, times[times.size() / 2], times.front() };
+                results.push_back(result);
+            }
+        }
+    }
+
+    //the pool never creates more threads than the machine has cores, the
+    //rows above that measure the same pool as the last row below it
+    //the cost of a factor is relative to the first factor of the list with
+    //the same block size and number of threads
+    std::printf("oversampling,threads,block_size,ns_per_sample,best_ns_per_sample,speedup,"
+                "relative_cost,hardware_threads,simd_width\n");
+    for (const Result& r : results) {
+        double single = findMedian(results, r.oversampling, 1, r.blockSize);
+        double base = findMedian(results, factors.front(), r.threads, r.blockSize);
+        std::printf("%d,%d,%d,%.4f,%.4f,%.2f,%.2f,%u,%d\n", (int) r.oversampling, (int) r.threads,
+                    (int) r.blockSize, r.median, r.best, single / r.median, r.median / base,
+                    std::thread::hardware_concurrency(), (int) simd::WIDTH);
+    }
+    return 0;
+}
@@ -1,10 +1,14 @@
 #ifndef CV_MODULES
-#define CVMODULES
+#define CV_MODULES
 
 #define _USE_MATH_DEFINES
 
 #include <pluginterfaces/vst/vsttypes.h>
 
+#include "paramramp.h"
+#include "sinekernels.h"
+
+#include <algorithm>
 #include <cmath>
 #include <vector>
 
@@ -22,10 +26,24 @@ protected:
 
 public:
     virtual void setSampleRate(Vst::SampleRate* _sampleRate) { sampleRate = *_sampleRate; }
+    virtual void setBlockSize(int32 maxSamples) { return; }    //modules that need buffers allocate them here
     virtual float output()=0;
+    virtual void process(float* out, int32 numSamples);         //renders a block, defaults to calling output()
 
     virtual bool isOn() { return true; }        //this is for optimization
     virtual void clear() { return; }            //modules that have lists of inputs have to be able to clear them
+
+    //the inputs of the module, they are rendered before it by PatchGraph
+    virtual int32 getNumInputs() { return 0; }
+    virtual CVModule* getInput(int32 index) { return nullptr; }
+    virtual bool forwardsInput() { return false; }  //the output is the only input, unchanged
+    virtual bool pullsInputs() { return true; }     //false if this block does not need the inputs
+    /** Renders a block from the rendered blocks of the inputs, `inputs` is
+        nullptr if pullsInputs() returned false, defaults to calling process() */
+    virtual void processInputs(float* out, const float* const* inputs, int32 numSamples);
+    /** A block PatchGraph does not render because no step reads it, modules
+        with moving parameters advance them here */
+    virtual void skip(int32 numSamples) { return; }
 };
 
 //-----------------------------------------------------------------------------
@@ -37,6 +55,7 @@ class NullModule : public CVModule
 {
 public:
     virtual float output();
+    virtual void process(float* out, int32 numSamples);
 };
 
 //-----------------------------------------------------------------------------
@@ -44,15 +63,18 @@ public:
 //-----------------------------------------------------------------------------
 class Camertone : public CVModule
 {
-    const float period;
-    float increment;
-    float phase;
+    Phase increment;
+    Phase phase;
+    SineQuality sineQuality;
 protected:
     void setIncrement();
 public:
     Camertone();
     virtual void setSampleRate(Vst::SampleRate* _sampleRate);
     virtual float output();
+    virtual void process(float* out, int32 numSamples);
+
+    void setSineQuality(SineQuality quality);
 };
 
 //-----------------------------------------------------------------------------
@@ -63,20 +85,29 @@ public:
 //-----------------------------------------------------------------------------
 class Oscillator : public CVModule
 {
-    float baseFreq;
-    float keyMod;
 protected:
-    const float period;
-    float increment;
-    float phase;
+    ParamRamp baseFreq;
+    float keyMod;
+    Phase increment;
+    Phase phase;
+    SineQuality sineQuality;
     void setIncrement();
+
+    //the FM oscillators add `mod` to the phase
+    float outputFM(float mod);
+    void processFM(float* out, const float* mod, int32 numSamples);
 public:
     Oscillator();
     virtual void setSampleRate(Vst::SampleRate* _sampleRate);
+    virtual void setBlockSize(int32 maxSamples);
     virtual float output();
+    virtual void process(float* out, int32 numSamples);
 
     virtual void setFrequency(Vst::ParamValue* freq);
+    virtual void rampFrequency(Vst::ParamValue* freq, int32 numSamples);
+    virtual void setFrequencySmoothing(SmoothingMode mode, float seconds);
     virtual void setKeyMod(float mod);
+    virtual void setSineQuality(SineQuality quality);
 };
 
 //-----------------------------------------------------------------------------
@@ -90,10 +121,15 @@ protected:
 public:
     OneInputOneOutputModule();
     virtual float output();
+    virtual void process(float* out, int32 numSamples);
 
     virtual void setInput(CVModule* _input);
 
     virtual bool isOn();
+
+    virtual int32 getNumInputs();
+    virtual CVModule* getInput(int32 index);
+    virtual bool forwardsInput();
 };
 
 //-----------------------------------------------------------------------------
@@ -102,15 +138,30 @@ public:
 class Amplifier : virtual public OneInputOneOutputModule
 {
 protected:
-    float volume;
+    ParamRamp volume;
+
+    template <typename Sample>
+    void applyVolume(Sample* out, const Sample* in, int32 numSamples);
 
 public:
     Amplifier();
+    virtual void setSampleRate(Vst::SampleRate* _sampleRate);
+    virtual void setBlockSize(int32 maxSamples);
     virtual float output();
+    virtual void process(float* out, int32 numSamples);
+    /** Applies the volume to a block of the 64-bit buses in double, the input
+        is rendered by the caller */
+    void amplify(double* out, const double* in, int32 numSamples);
 
     void setVolume(Vst::ParamValue* _volume);
+    void rampVolume(Vst::ParamValue* _volume, int32 numSamples);
+    void setVolumeSmoothing(SmoothingMode mode, float seconds);
 
     virtual bool isOn();
+
+    virtual bool forwardsInput();
+    virtual bool pullsInputs();
+    virtual void processInputs(float* out, const float* const* inputs, int32 numSamples);
 };
 
 //-----------------------------------------------------------------------------
@@ -120,14 +171,24 @@ class ModOnlyAmp : virtual public OneInputOneOutputModule
 {
 protected:
     CVModule* modulator;
+    std::vector<float> modBuffer;
 
 public:
     ModOnlyAmp();
+    virtual void setBlockSize(int32 maxSamples);
     virtual float output();
+    virtual void process(float* out, int32 numSamples);
 
     void setModulator(CVModule* mod);
 
     virtual bool isOn();
+
+    //the modulator is input 0, the input is input 1
+    virtual int32 getNumInputs();
+    virtual CVModule* getInput(int32 index);
+    virtual bool forwardsInput();
+    virtual bool pullsInputs();
+    virtual void processInputs(float* out, const float* const* inputs, int32 numSamples);
 };
 
 //-----------------------------------------------------------------------------
@@ -135,10 +196,19 @@ public:
 //-----------------------------------------------------------------------------
 class ModAmp : public Amplifier, public ModOnlyAmp
 {
+    void applyModulation(float* out, const float* in, const float* mod, int32 numSamples);
 public:
+    virtual void setBlockSize(int32 maxSamples);
     virtual float output();
+    virtual void process(float* out, int32 numSamples);
     
     virtual bool isOn();
+
+    virtual int32 getNumInputs();
+    virtual CVModule* getInput(int32 index);
+    virtual bool forwardsInput();
+    virtual bool pullsInputs();
+    virtual void processInputs(float* out, const float* const* inputs, int32 numSamples);
 };
 
 //-----------------------------------------------------------------------------
@@ -161,6 +231,7 @@ class Gate : public Triggerable
 public:
     Gate() { on = false; }
     virtual float output();
+    virtual void process(float* out, int32 numSamples);
 
     virtual bool isOn();
 
@@ -176,10 +247,14 @@ class SmoothGate : public Triggerable
     float value;
     int phase;
     float increment;
+
+    //renders up to the end of the current stage, at least one sample
+    int32 renderSegment(float* out, int32 numSamples);
 public:
     SmoothGate();
     virtual void setSampleRate(Vst::SampleRate* _sampleRate);
     virtual float output();
+    virtual void process(float* out, int32 numSamples);
 
     virtual bool isOn();
 
@@ -210,20 +285,84 @@ class LinearADSR : public Triggerable
     virtual void setDecayIncrement();
     virtual void setReleaseIncrement();
 
+    //renders up to the end of the current stage, at least one sample
+    int32 renderSegment(float* out, int32 numSamples);
+
 public:
     LinearADSR();
     virtual void setSampleRate(Vst::SampleRate* _sampleRate);
     virtual float output();
+    virtual void process(float* out, int32 numSamples);
     
     virtual bool isOn();
 
     virtual void press();
     virtual void release();
 
+    float getValue();
+
+    virtual void setAttack(Vst::ParamValue* _value);
+    virtual void setDecay(Vst::ParamValue* _value);
+    virtual void setSustain(Vst::ParamValue* _value);
+    virtual void setRelease(Vst::ParamValue* _value);
+};
+
+//-----------------------------------------------------------------------------
+/** An ADSR envelope generator with exponential stages, like an analog one.
+    Every stage moves the value towards a target with one multiply-add per
+    sample: the attack aims above 1 and stops at 1, the decay and the release
+    approach the sustain level and 0 and end once they are closer than the
+    threshold, so a released envelope goes idle instead of tailing off.
+  * The times are measured across the whole range: from 0 to 1 for the
+    attack, from 1 to the threshold for the decay and the release. */
+//-----------------------------------------------------------------------------
+class ExponentialADSR : public Triggerable
+{
+    float value;
+    int phase;
+
+    //parameters
+    float attackLevel;
+    float decayLevel;
+    float sustainLevel;
+    float releaseLevel;
+    float threshold;
+
+    //every sample value = value * coefficient + offset
+    float attackCoefficient;
+    float attackOffset;
+    float decayCoefficient;
+    float decayOffset;
+    float releaseCoefficient;
+
+    virtual void setAttackCoefficient();
+    virtual void setDecayCoefficient();
+    virtual void setReleaseCoefficient();
+
+    //renders up to the end of the current stage, at least one sample
+    int32 renderSegment(float* out, int32 numSamples);
+public:
+    static const float DEFAULT_THRESHOLD;     //-80 dB
+
+    ExponentialADSR();
+    virtual void setSampleRate(Vst::SampleRate* _sampleRate);
+    virtual float output();
+    virtual void process(float* out, int32 numSamples);
+
+    virtual bool isOn();
+
+    virtual void press();
+    virtual void release();
+
+    float getValue();
+
     virtual void setAttack(Vst::ParamValue* _value);
     virtual void setDecay(Vst::ParamValue* _value);
     virtual void setSustain(Vst::ParamValue* _value);
     virtual void setRelease(Vst::ParamValue* _value);
+    /** The distance from the sustain level or from 0 at which the decay and
+        the release end, in (0, 1) */
+    virtual void setThreshold(Vst::ParamValue* _value);
 };
 
 //-----------------------------------------------------------------------------
@@ -235,13 +374,20 @@ class Mixer : public CVModule
 protected:
     int numInputs;
     std::vector<CVModule*> inputs;
+    std::vector<float> inputBuffer;
 public:
     Mixer();
+    virtual void setBlockSize(int32 maxSamples);
     virtual float output();
+    virtual void process(float* out, int32 numSamples);
     
     virtual void clear();
 
-    void addInput(CVModule* input);
+    void addInput(CVModule* input);     //allocates, the patch is wired before it is rendered
+
+    virtual int32 getNumInputs();
+    virtual CVModule* getInput(int32 index);
+    virtual void processInputs(float* out, const float* const* inputs, int32 numSamples);
 };
 
 //-----------------------------------------------------------------------------
@@ -250,34 +396,194 @@ public:
 class FMOsc : public Oscillator
 {
     CVModule* modulator;
+    std::vector<float> modBuffer;
 public:
     FMOsc();
+    virtual void setBlockSize(int32 maxSamples);
     virtual float output();
+    virtual void process(float* out, int32 numSamples);
 
     void setModulator(CVModule* mod);
+
+    virtual int32 getNumInputs();
+    virtual CVModule* getInput(int32 index);
+    virtual void processInputs(float* out, const float* const* inputs, int32 numSamples);
 };
 
 //-----------------------------------------------------------------------------
-/** An FM Operator with an envelope and multiple modulation inputs */
+/** Statically dispatched versions of ModAmp and FMOsc, only used by
+    FMOperator. They behave like them, but their inputs are pointers to a
+    known type and are called with qualified names
+    (`input->Input::process()`), so the calls along the chain of FMOperator
+    are bound at compile time and can be inlined. An input of a derived type
+    is called as `Input`.
+    StaticModAmp is not a CVModule, FMOperator shows its inputs to PatchGraph.
+    StaticFMOsc is an Oscillator for its frequency and phase, so it keeps the
+    vtable of a CVModule, but it calls its modulator statically and
+    FMOperator calls it the same way. */
+//-----------------------------------------------------------------------------
+
+/** Unlike ModAmp, the modulator has to be connected */
+template <class Input, class Modulator>
+class StaticModAmp
+{
+    Input* input;
+    ParamRamp volume;
+    Modulator* modulator;
+    std::vector<float> modBuffer;
+
+    void apply(float* out, const float* in, int32 numSamples);
+
+public:
+    StaticModAmp();
+    void setSampleRate(Vst::SampleRate* _sampleRate) { volume.setSampleRate(_sampleRate); }
+    void setBlockSize(int32 maxSamples);
+    bool isOn() { return !volume.isSilent() && modulator->Modulator::isOn(); }
+
+    float output();
+    void process(float* out, int32 numSamples);
+    void processFrom(float* out, const float* in, int32 numSamples);  //`in` is the rendered input, it can be `out`
+    void silence(float* out, int32 numSamples);                         //the block of an amplifier that is off
+
+    void setInput(Input* _input) { input = _input; }
+    void setModulator(Modulator* mod) { modulator = mod; }
+    void setVolume(Vst::ParamValue* _volume) { volume.setTarget(*_volume); }
+    void rampVolume(Vst::ParamValue* _volume, int32 numSamples) { volume.rampTo(*_volume, numSamples); }
+    void setVolumeSmoothing(SmoothingMode mode, float seconds) { volume.setSmoothing(mode, seconds); }
+};
+
+//-----------------------------------------------------------------------------
+/** Unlike FMOsc, the modulator has to be connected */
+template <class Modulator>
+class StaticFMOsc : public Oscillator
+{
+    Modulator* modulator;
+    std::vector<float> modBuffer;
+
+public:
+    StaticFMOsc() : modulator(nullptr) {}
+    virtual void setBlockSize(int32 maxSamples);
+    virtual float output() { return outputFM(modulator->Modulator::output()); }
+    virtual void process(float* out, int32 numSamples);
+    void processFrom(float* out, const float* mod, int32 numSamples) { processFM(out, mod, numSamples); }
+
+    void setModulator(Modulator* mod) { modulator = mod; }
+};
+
+//-----------------------------------------------------------------------------
+template <class Input, class Modulator>
+StaticModAmp<Input, Modulator>::StaticModAmp() {
+    input = nullptr;
+    modulator = nullptr;
+    volume.setValue(1);
+    volume.setSmoothing(kSmoothOnePole, DEFAULT_VOLUME_SMOOTHING);
+}
+
+template <class Input, class Modulator>
+void StaticModAmp<Input, Modulator>::setBlockSize(int32 maxSamples) {
+    volume.setBlockSize(maxSamples);
+    modBuffer.resize(maxSamples);
+}
+
+template <class Input, class Modulator>
+float StaticModAmp<Input, Modulator>::output() {
+    if (isOn()) {
+        return volume.next() * modulator->Modulator::output() * input->Input::output();
+    }
+    volume.skip(1);
+    return 0;
+}
+
+template <class Input, class Modulator>
+void StaticModAmp<Input, Modulator>::process(float* out, int32 numSamples) {
+    if (!isOn()) {
+        silence(out, numSamples);
+        return;
+    }
+    modulator->Modulator::process(modBuffer.data(), numSamples);
+    input->Input::process(out, numSamples);
+    apply(out, out, numSamples);
+}
+
+template <class Input, class Modulator>
+void StaticModAmp<Input, Modulator>::processFrom(float* out, const float* in, int32 numSamples) {
+    modulator->Modulator::process(modBuffer.data(), numSamples);
+    apply(out, in, numSamples);
+}
+
+template <class Input, class Modulator>
+void StaticModAmp<Input, Modulator>::silence(float* out, int32 numSamples) {
+    volume.skip(numSamples);
+    std::fill(out, out + numSamples, 0.f);
+}
+
+template <class Input, class Modulator>
+void StaticModAmp<Input, Modulator>::apply(float* out, const float* in, int32 numSamples) {
+    if (volume.isSettled()) {
+        const float gain = volume.getValue();
+        for (int32 i = 0; i < numSamples; i++) {
+            out[i] = in[i] * (gain * modBuffer[i]);
+        }
+        return;
+    }
+    const float* gain = volume.render(numSamples);
+    for (int32 i = 0; i < numSamples; i++) {
+        out[i] = in[i] * (gain[i] * modBuffer[i]);
+    }
+}
+
+template <class Modulator>
+void StaticFMOsc<Modulator>::setBlockSize(int32 maxSamples) {
+    Oscillator::setBlockSize(maxSamples);
+    modBuffer.resize(maxSamples);
+}
+
+template <class Modulator>
+void StaticFMOsc<Modulator>::process(float* out, int32 numSamples) {
+    modulator->Modulator::process(modBuffer.data(), numSamples);
+    processFM(out, modBuffer.data(), numSamples);
+}
+
+//-----------------------------------------------------------------------------
+/** An FM Operator with an envelope and multiple modulation inputs,
+    the oscillator, the envelope and the amplifier are bound statically.
+    The synth renders its voices with FMVoiceBank, the operator is only
+    measured by bench/cvmodules.cpp */
 //-----------------------------------------------------------------------------
 class FMOperator : public Oscillator
 {
-    FMOsc osc;
+    typedef StaticFMOsc<Mixer> Osc;
+
+    Osc osc;
     Mixer mixer;
-    ModAmp amp;
+    StaticModAmp<Osc, LinearADSR> amp;
     LinearADSR envelope;
+    std::vector<float> mixBuffer;   //the sum of the modulators rendered by a PatchGraph
 public:
     FMOperator();
     virtual void setSampleRate(Vst::SampleRate* _sampleRate);
+    virtual void setBlockSize(int32 maxSamples);
     virtual float output();
+    virtual void process(float* out, int32 numSamples);
     
     virtual void clear();
 
+    //the inputs are the modulators, the operator is one step of a PatchGraph
+    virtual int32 getNumInputs();
+    virtual CVModule* getInput(int32 index);
+    virtual bool pullsInputs();
+    virtual void processInputs(float* out, const float* const* inputs, int32 numSamples);
+
     virtual void setFrequency(Vst::ParamValue* freq);
+    virtual void rampFrequency(Vst::ParamValue* freq, int32 numSamples);
+    virtual void setFrequencySmoothing(SmoothingMode mode, float seconds);
     virtual void setKeyMod(float mod);
+    virtual void setSineQuality(SineQuality quality);
 
     void addModulator(CVModule* mod);
     void setVolume(Vst::ParamValue* volume);
+    void rampVolume(Vst::ParamValue* volume, int32 numSamples);
+    void setVolumeSmoothing(SmoothingMode mode, float seconds);
     void setAttack(Vst::ParamValue* _value);
     void setDecay(Vst::ParamValue* _value);
     void setSustain(Vst::ParamValue* _value);
@@ -0,0 +1,81 @@
+#ifndef DECIMATOR
+#define DECIMATOR
+
+#include <pluginterfaces/base/ftypes.h>
+
+#include <vector>
+
+namespace Steinberg {
+namespace Synth {
+
+//-----------------------------------------------------------------------------
+/** Halves the sample rate with a linear phase half-band FIR of 4 * numPairs - 1
+    taps. Every other tap of a half-band filter is zero and the centre tap is
+    0.5, so one output costs numPairs multiplications: the input is split into
+    its even and odd samples (the two polyphase branches) and simd::WIDTH
+    outputs are computed at once from contiguous loads. `Sample` is float or
+    double, the double stages keep the taps and the history in double and
+    only have the scalar loop. */
+//-----------------------------------------------------------------------------
+template <typename Sample>
+class HalfBandDecimator
+{
+    std::vector<Sample> coefs;      //the taps next to the centre, outwards
+    int32 numPairs;
+    std::vector<Sample> even;       //2 * numPairs - 1 samples of history, then the block
+    std::vector<Sample> odd;        //numPairs samples of history, then the block
+
+public:
+    HalfBandDecimator();
+
+    /** Designs the filter (a Kaiser windowed sinc) and allocates the history */
+    void setup(int32 _numPairs, int32 maxOutput);
+    void reset();
+    /** Reads 2 * numOutput samples of `in` */
+    void process(const Sample* in, Sample* out, int32 numOutput);
+    /** The group delay in input samples */
+    int32 getLatency() { return 2 * numPairs - 1; }
+};
+
+//-----------------------------------------------------------------------------
+/** Brings a signal rendered at 2, 4 or 8 times the output rate back to it
+    with a cascade of half-band stages. The stage at the output rate has the
+    narrowest transition band (alias-free up to 0.4 times the output rate,
+    about 74 dB down), the stages before it only have to keep their images out
+    of what the next stage passes, so they have fewer taps.
+    Instantiated for float and double, in decimator.cpp. */
+//-----------------------------------------------------------------------------
+template <typename Sample>
+class Decimator
+{
+public:
+    static const int32 MAX_FACTOR = 8;
+
+private:
+    static const int32 MAX_STAGES = 3;
+    HalfBandDecimator<Sample> stages[MAX_STAGES];
+    int32 numStages;
+    int32 maxSamples;
+    std::vector<Sample> buffer;     //the output of every stage but the last one
+
+public:
+    Decimator();
+
+    /** 1 passes the signal through, setup() allocates */
+    void setup(int32 factor, int32 _maxSamples);
+    void reset();
+    /** Reads factor * numSamples samples of `in` and writes numSamples to `out` */
+    void process(const Sample* in, Sample* out, int32 numSamples);
+
+    int32 getFactor() { return 1 << numStages; }
+    /** The group delay in output samples */
+    float getLatency();
+};
+
+template <typename Sample>
+const int32 Decimator<Sample>::MAX_FACTOR;
+
+} //namespace Synth
+} //namespace Steinberg
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef FM_ALGORITHM_TABLE
+#define FM_ALGORITHM_TABLE
+
+#include <pluginterfaces/base/ftypes.h>
+
+namespace Steinberg {
+namespace Synth {
+
+const int32 MAX_FM_OPERATORS = 6;
+
+//-----------------------------------------------------------------------------
+/** How the operators of an FM voice are wired, like the algorithms of the
+    Yamaha DX synths. The operators are rendered from the first to the last,
+    an operator can be modulated by the ones before it (and by itself, with
+    its feedback), so the DX numbering is reversed: here the last operator is
+    always a carrier.
+    The table is read at compile time, FMVoiceBank renders every algorithm
+    with its own kernel in which the wiring is fixed. The sum of the
+    carriers is scaled by the gain, so all the carriers at full level are as
+    loud as one and changing the algorithm does not jump in level. */
+//-----------------------------------------------------------------------------
+struct FMAlgorithm
+{
+    int32 numOperators;
+    uint8 modulators[MAX_FM_OPERATORS];     //bit m: operator m modulates this one
+    uint8 carriers;                         //bit op: operator op is heard
+    float gain;                             //1 / the number of carriers, scales their sum
+};
+
+//the operators are numbered from 1 in the comments, ">" is "modulates"
+constexpr FMAlgorithm FM_ALGORITHMS[] = {
+    //2 operators, the original patch of the synth
+    { 2, { 0, 1 },                      0x02, 1.f },        //1>2
+
+    //4 operators
+    { 4, { 0, 1, 2, 4 },                0x08, 1.f },        //1>2>3>4
+    { 4, { 0, 0, 3, 4 },                0x08, 1.f },        //(1+2)>3>4
+    { 4, { 0, 1, 0, 6 },                0x08, 1.f },        //1>2>4, 3>4
+    { 4, { 0, 1, 1, 6 },                0x08, 1.f },        //1>2>4, 1>3>4
+    { 4, { 0, 1, 0, 4 },                0x0a, 1.f / 2 },    //1>2, 3>4
+    { 4, { 0, 1, 1, 1 },                0x0e, 1.f / 3 },    //1>2, 1>3, 1>4
+    { 4, { 0, 1, 0, 0 },                0x0e, 1.f / 3 },    //1>2, 3, 4
+    { 4, { 0, 0, 0, 0 },                0x0f, 1.f / 4 },    //1, 2, 3, 4
+
+    //6 operators
+    { 6, { 0, 1, 2, 4, 8, 16 },         0x20, 1.f },        //1>2>3>4>5>6
+    { 6, { 0, 1, 2, 4, 0, 16 },         0x28, 1.f / 2 },    //1>2>3>4, 5>6
+    { 6, { 0, 1, 0, 4, 0, 16 },         0x2a, 1.f / 3 },    //1>2, 3>4, 5>6
+    { 6, { 0, 1, 0, 4, 0, 26 },         0x20, 1.f },        //1>2>6, 3>4>6, 5>6
+    { 6, { 0, 1, 0, 6, 0, 16 },         0x28, 1.f / 2 },    //1>2>4, 3>4, 5>6
+    { 6, { 0, 1, 1, 0, 8, 16 },         0x26, 1.f / 3 },    //1>2, 1>3, 4>5>6
+    { 6, { 0, 1, 1, 1, 0, 16 },         0x2e, 1.f / 4 },    //1>2, 1>3, 1>4, 5>6
+    { 6, { 0, 0, 0, 0, 0, 0 },          0x3f, 1.f / 6 },    //1, 2, 3, 4, 5, 6
+};
+
+//indices 0 to 16: one 2 operator, eight 4 operator and eight 6 operator algorithms
+const int32 kNumFMAlgorithms = sizeof(FM_ALGORITHMS) / sizeof(FM_ALGORITHMS[0]);
+static_assert(kNumFMAlgorithms == 17, "the Algorithm parameter and the docs list 17 algorithms");
+
+/** Whether operator m modulates operator op in the algorithm */
+constexpr bool modulates(int32 algorithm, int32 m, int32 op) {
+    return (FM_ALGORITHMS[algorithm].modulators[op] >> m) & 1;
+}
+
+/** Whether operator op of the algorithm is heard */
+constexpr bool isCarrier(int32 algorithm, int32 op) {
+    return (FM_ALGORITHMS[algorithm].carriers >> op) & 1;
+}
+
+constexpr int32 countCarriers(uint8 carriers) {
+    return carriers ? (carriers & 1) + countCarriers(carriers >> 1) : 0;
+}
+
+/** Whether the gains of the algorithms from `algorithm` on match their carriers */
+constexpr bool hasCarrierGains(int32 algorithm = 0) {
+    return algorithm == kNumFMAlgorithms ||
+           (FM_ALGORITHMS[algorithm].gain * countCarriers(FM_ALGORITHMS[algorithm].carriers) == 1.f &&
+            hasCarrierGains(algorithm + 1));
+}
+
+static_assert(hasCarrierGains(), "the gain of an algorithm is 1 / its number of carriers");
+
+} //namespace Synth
+} //namespace Steinberg
+
+#endif
@@ -12,6 +12,7 @@ namespace Steinberg {
 namespace Synth {
 
 const float SEMI_TONE_MULTIPLIER = pow(2.0, 1.0 / 12.0);
+const int32 MAX_PITCH_BEND_RANGE = 24;  //semitones up and down
 
 //-----------------------------------------------------------------------------
 /** A base class for modules converting MIDI events to CV */
@@ -46,18 +47,98 @@ public:
 };
 
 //-----------------------------------------------------------------------------
+/** The frequency ratio of a MIDI key to A4 (key 69), from a table */
 float pitchToCV(int16* pitch);
 
+/** 2 ^ (semitones / 12), the ratio of a pitch bend. A polynomial instead of
+    pow, within 0.001 cent, cheap enough for every point of the bend */
+float semitonesToRatio(float semitones);
+
 //-----------------------------------------------------------------------------
-/** A simple monophonic keyboard that prioritizes the highest pressed key */
+/** The MIDI keys that are held, in a 128 bit set and in a list in the order
+    they were pressed, linked through two arrays indexed by the key.
+    Pressing, releasing and finding the last, highest or lowest held key are
+    constant time, nothing is allocated. Keys outside 0 .. NUM_KEYS - 1 are
+    ignored. */
 //-----------------------------------------------------------------------------
-class HighestDumbMonoKeyboard : public DumbMonoKeyboard
+class HeldKeys
 {
-    int16 currentPitch;
 public:
-    HighestDumbMonoKeyboard();
+    static const int16 NUM_KEYS = 128;
+
+private:
+    uint64 bits[2];
+    int16 previous[NUM_KEYS];   //the key pressed before it, -1 for the first one
+    int16 next[NUM_KEYS];       //the key pressed after it, -1 for the last one
+    int16 first;
+    int16 last;
+    int32 count;
+
+    void unlink(int16 key);
+
+public:
+    HeldKeys();
+
+    /** A key that is held already becomes the last one pressed */
+    void press(int16 key);
+    void release(int16 key);
+    void clear();
+
+    bool isHeld(int16 key);
+    bool isEmpty() { return count == 0; }
+    int32 getCount() { return count; }
+
+    //-1 if no key is held
+    int16 getLast() { return last; }
+    int16 getHighest();
+    int16 getLowest();
+};
+
+//-----------------------------------------------------------------------------
+/** Which held key a monophonic keyboard plays */
+//-----------------------------------------------------------------------------
+enum NotePriority
+{
+    kPriorityLast = 0,
+    kPriorityHighest,
+    kPriorityLowest,
+
+    kNumNotePriorities
+};
+
+//-----------------------------------------------------------------------------
+/** A monophonic keyboard that tracks all held keys and plays one of them.
+    The gate opens with the first key and closes with the last one, in between
+    the pitch follows the key chosen by the priority, releasing it goes back
+    to the next one. With `retrigger` a pressed key that takes over triggers
+    the gate again, otherwise it plays legato. */
+//-----------------------------------------------------------------------------
+class PriorityMonoKeyboard : public DumbMonoKeyboard
+{
+    HeldKeys keys;
+    NotePriority priority;
+    bool retrigger;
+    int16 currentPitch;         //-1 while no key is held
+
+    int16 chooseKey();
+    void follow();
+
+public:
+    PriorityMonoKeyboard(NotePriority _priority = kPriorityLast, bool _retrigger = false);
     virtual void keyOn(int16* pitch);
     virtual void keyOff(int16* pitch);
+
+    void setPriority(NotePriority _priority);
+};
+
+//-----------------------------------------------------------------------------
+/** A monophonic keyboard that prioritizes the highest pressed key,
+    a higher key triggers the envelope again */
+//-----------------------------------------------------------------------------
+class HighestDumbMonoKeyboard : public PriorityMonoKeyboard
+{
+public:
+    HighestDumbMonoKeyboard() : PriorityMonoKeyboard(kPriorityHighest, true) {}
 };
 
 //-----------------------------------------------------------------------------
@@ -65,12 +146,82 @@ public:
     this keyboard tracks all pressed keys.
 */
 //-----------------------------------------------------------------------------
-class LastMonoKeyboard : public DumbMonoKeyboard
+class LastMonoKeyboard : public PriorityMonoKeyboard
 {
-    std::vector<int16> pressedKeys;
 public:
+    LastMonoKeyboard() : PriorityMonoKeyboard(kPriorityLast) {}
+};
+
+//-----------------------------------------------------------------------------
+/** Which voice a polyphonic keyboard takes over when all voices are busy */
+//-----------------------------------------------------------------------------
+enum StealMode
+{
+    kStealOldest = 0,
+    kStealQuietest,
+
+    kNumStealModes
+};
+
+//-----------------------------------------------------------------------------
+/** A base class for polyphonic keyboards, they own a fixed pool of voices and
+    are the module producing their sum.
+    This class assigns keys to voices, subclasses store and render the voices.
+    All voices are allocated with the keyboard, so pressing a key never 
+    allocates memory. Only the first `polyphony` voices are assigned to keys.
+*/
+//-----------------------------------------------------------------------------
+class PolyKeyboard : public Keyboard, public CVModule
+{
+public:
+    static const int32 MAX_POLYPHONY = 64;
+
+private:
+    int16 voicePitch[MAX_POLYPHONY];        //-1 if the voice was never assigned
+    bool voiceHeld[MAX_POLYPHONY];
+    uint64 voiceStamp[MAX_POLYPHONY];       //when the voice was assigned
+    int16 keyVoice[HeldKeys::NUM_KEYS];     //the voice holding the key, -1 if it is not held
+
+    int32 polyphony;
+    StealMode stealMode;
+    uint64 stampCounter;
+
+    int32 findVoice();
+    void releaseHeld(int32 voice);
+
+protected:
+    virtual bool isVoiceOn(int32 voice)=0;
+    virtual float getVoiceLevel(int32 voice)=0;
+    virtual void startVoice(int32 voice, int16* pitch)=0;
+    virtual void releaseVoice(int32 voice)=0;
+
+public:
+    PolyKeyboard();
     virtual void keyOn(int16* pitch);
     virtual void keyOff(int16* pitch);
+    void allNotesOff();
+
+    virtual bool isOn();
+
+    void setPolyphony(int32 _polyphony);
+    void setStealMode(StealMode mode);
+
+    //parameters shared by all voices, `op` is the index of the operator
+    virtual void setOperatorVolume(int32 op, Vst::ParamValue* volume)=0;
+    virtual void setOperatorFrequency(int32 op, Vst::ParamValue* freq)=0;
+    virtual void rampOperatorVolume(int32 op, Vst::ParamValue* volume, int32 numSamples)=0;
+    virtual void rampOperatorFrequency(int32 op, Vst::ParamValue* freq, int32 numSamples)=0;
+    virtual void setVolumeSmoothing(SmoothingMode mode, float seconds)=0;
+    virtual void setFrequencySmoothing(SmoothingMode mode, float seconds)=0;
+    virtual void setOperatorAttack(int32 op, Vst::ParamValue* _value)=0;
+    virtual void setOperatorDecay(int32 op, Vst::ParamValue* _value)=0;
+    virtual void setOperatorSustain(int32 op, Vst::ParamValue* _value)=0;
+    virtual void setOperatorRelease(int32 op, Vst::ParamValue* _value)=0;
+    virtual void setSineQuality(SineQuality quality)=0;
+
+    /** The pitch bend as a ratio of the frequency of every key, reached
+        linearly after numSamples, or smoothed if it is 0 */
+    virtual void rampPitchBend(Vst::ParamValue* ratio, int32 numSamples)=0;
 };
 
 } //namespace Synth
@@ -0,0 +1,83 @@
+#ifndef PARAM_RAMP
+#define PARAM_RAMP
+
+#include <pluginterfaces/vst/vsttypes.h>
+
+#include <vector>
+
+namespace Steinberg {
+namespace Synth {
+
+//-----------------------------------------------------------------------------
+/** How a ParamRamp moves to a value set with setTarget */
+//-----------------------------------------------------------------------------
+enum SmoothingMode
+{
+    kSmoothNone = 0,        //the value jumps
+    kSmoothLinear,          //constant speed, the value arrives after the smoothing time
+    kSmoothOnePole,         //exponential approach, the smoothing time is the time constant
+
+    kNumSmoothingModes
+};
+
+//the smoothing the modules start with, in seconds
+const float DEFAULT_VOLUME_SMOOTHING = 0.005f;          //one-pole
+const float DEFAULT_FREQUENCY_SMOOTHING = 0.005f;       //linear
+
+//-----------------------------------------------------------------------------
+/** A parameter that moves smoothly to new values instead of jumping,
+    either linearly over a given number of samples (this is how the automation
+    between the points of a IParamValueQueue is applied) or with its own
+    smoothing mode and time (this is how the knobs are applied).
+    While the value is moving, render() writes it for every sample of a block
+    to a buffer owned by the ramp, with vector instructions. Once it has
+    arrived the modules read getValue() and skip the buffer, so a parameter
+    that is not moving costs nothing. */
+//-----------------------------------------------------------------------------
+class ParamRamp
+{
+    float value;
+    float target;
+
+    //the linear ramp
+    float start;
+    int32 length;
+    int32 position;         //the linear ramp is done when position == length
+
+    //the one-pole filter
+    bool decaying;
+    float coefficient;      //how much of the distance to the target is left after one sample
+
+    SmoothingMode mode;
+    float smoothingTime;
+    Vst::SampleRate sampleRate;
+    std::vector<float> buffer;
+
+    void setCoefficient();
+    void settle();
+    void startRamp(float _target, int32 numSamples);
+
+public:
+    ParamRamp();
+    void setSampleRate(Vst::SampleRate* _sampleRate);
+    void setBlockSize(int32 maxSamples);
+    void setSmoothing(SmoothingMode _mode, float seconds);
+
+    void setValue(float _value);                        //jumps to the value
+    void setTarget(float _target);                      //moves to the value with the smoothing
+    void rampTo(float _target, int32 numSamples);       //reaches the value after numSamples samples,
+                                                        //with the smoothing if numSamples is 0
+
+    bool isSettled() { return position == length && !decaying; }
+    bool isSilent() { return isSettled() && value == 0; }
+    float getValue() { return value; }
+
+    float next();                           //advances by one sample and returns the value
+    const float* render(int32 numSamples);  //the values of the next numSamples samples
+    void skip(int32 numSamples);            //advances without writing the values
+};
+
+} //namespace Synth
+} //namespace Steinberg
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef PATCH_GRAPH
+#define PATCH_GRAPH
+
+#include <pluginterfaces/vst/vsttypes.h>
+
+#include "cvmodules.h"
+
+#include <vector>
+
+namespace Steinberg {
+namespace Synth {
+
+//-----------------------------------------------------------------------------
+/** A patch of modules compiled into a flat list of block-render steps.
+    compile() sorts the modules feeding the output module so that every
+    module comes after its inputs (see CVModule::getInput) and gives every
+    step a buffer, process() renders the steps in a loop, each module reading
+    the buffers of its inputs instead of pulling them recursively.
+    A module read by several modules (an operator modulating two carriers,
+    a module in a Mixer and in a modulation input) is rendered once per
+    block, all of them read its buffer; pulled, it advanced once per reader.
+    The buffers are reused once their last reader has run, the last step
+    renders straight into the output.
+    A patch with feedback cannot be sorted, it is rendered by pulling the
+    output module like before.
+    compile() allocates, it has to be called again when the patch is rewired. */
+//-----------------------------------------------------------------------------
+class PatchGraph
+{
+    struct Step
+    {
+        CVModule* module;
+        int32 firstInput;       //the first entry of inputSteps for this step
+        int32 numInputs;
+        int32 buffer;           //-1 for the last step, it renders into the output
+    };
+
+    CVModule* output;
+    bool compiled;
+    int32 maxSamples;
+
+    std::vector<Step> steps;
+    std::vector<int32> inputSteps;          //the steps rendering the inputs of each step
+    std::vector<const float*> inputBlocks;  //the buffers of inputSteps while a block is rendered
+    std::vector<float> buffers;             //numBuffers blocks of maxSamples
+    int32 numBuffers;
+    std::vector<char> needed;               //the step is rendered in this block
+    std::vector<char> pulls;                //the step reads its inputs in this block
+
+    int32 addStep(CVModule* module, std::vector<CVModule*>& path);
+    void assignBuffers();
+    void processBlock(float* out, int32 numSamples);
+
+public:
+    PatchGraph();
+
+    bool compile(CVModule* _output, int32 _maxSamples);    //false if the patch has feedback
+    void clear();
+    void process(float* out, int32 numSamples);
+
+    bool isCompiled() { return compiled; }
+    int32 getNumSteps() { return (int32) steps.size(); }
+    int32 getNumBuffers() { return numBuffers; }
+};
+
+} //namespace Synth
+} //namespace Steinberg
+
+#endif
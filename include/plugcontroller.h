@@ -37,12 +37,13 @@
 #pragma once
 
 #include "public.sdk/source/vst/vsteditcontroller.h"
+#include "pluginterfaces/vst/ivstmidicontrollers.h"
 
 namespace Steinberg {
 namespace Synth {
 
 //-----------------------------------------------------------------------------
-class PlugController : public Vst::EditController
+class PlugController : public Vst::EditController, public Vst::IMidiMapping
 {
 public:
 //------------------------------------------------------------------------
@@ -59,6 +60,19 @@ public:
 
 	//---from EditController-----
 	tresult PLUGIN_API setComponentState (IBStream* state) SMTG_OVERRIDE;
+	tresult PLUGIN_API setParamNormalized (Vst::ParamID tag, Vst::ParamValue value) SMTG_OVERRIDE;
+
+	//---from IMidiMapping-------
+	tresult PLUGIN_API getMidiControllerAssignment (int32 busIndex, int16 channel,
+	                                                Vst::CtrlNumber midiControllerNumber,
+	                                                Vst::ParamID& id) SMTG_OVERRIDE;
+
+	//---Interface---------------
+	OBJ_METHODS (PlugController, Vst::EditController)
+	DEFINE_INTERFACES
+		DEF_INTERFACE (Vst::IMidiMapping)
+	END_DEFINE_INTERFACES (Vst::EditController)
+	REFCOUNT_METHODS (Vst::EditController)
 };
 
 //------------------------------------------------------------------------
@@ -57,6 +57,60 @@ enum SynthParams : Vst::ParamID
 	kParamOp2_releaseId = 111,
 
 	kParamMasterVolumeId = 112,
+
+	kParamSineQualityId = 113,
+
+	kParamPolyphonyId = 114,
+	kParamVoiceStealingId = 115,
+
+	kParamRenderThreadsId = 116,
+	kParamOversamplingId = 117,
+
+	kParamPitchBendId = 118,
+	kParamPitchBendRangeId = 119,
+
+	// the wiring of the operators, an index of FM_ALGORITHMS
+	kParamAlgorithmId = 120,
+
+	kParamOp1_feedbackId = 121,
+	kParamOp2_feedbackId = 122,
+
+	// operators 3 to 6, only rendered by the algorithms with more operators
+	kParamOp3_levelId = 123,
+	kParamOp3_frequencyId = 124,
+	kParamOp3_attackId = 125,
+	kParamOp3_decayId = 126,
+	kParamOp3_sustainId = 127,
+	kParamOp3_releaseId = 128,
+	kParamOp3_feedbackId = 129,
+
+	kParamOp4_levelId = 130,
+	kParamOp4_frequencyId = 131,
+	kParamOp4_attackId = 132,
+	kParamOp4_decayId = 133,
+	kParamOp4_sustainId = 134,
+	kParamOp4_releaseId = 135,
+	kParamOp4_feedbackId = 136,
+
+	kParamOp5_levelId = 137,
+	kParamOp5_frequencyId = 138,
+	kParamOp5_attackId = 139,
+	kParamOp5_decayId = 140,
+	kParamOp5_sustainId = 141,
+	kParamOp5_releaseId = 142,
+	kParamOp5_feedbackId = 143,
+
+	kParamOp6_levelId = 144,
+	kParamOp6_frequencyId = 145,
+	kParamOp6_attackId = 146,
+	kParamOp6_decayId = 147,
+	kParamOp6_sustainId = 148,
+	kParamOp6_releaseId = 149,
+	kParamOp6_feedbackId = 150,
+
+	// hidden and read only, not part of the state: the processor sets it when
+	// it needs to be restarted, see PlugProcessor::requestRestart
+	kParamRestartId = 151,
 };
 
 
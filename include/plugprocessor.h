@@ -39,7 +39,14 @@
 #include "public.sdk/source/vst/vstaudioeffect.h"
 
 //#include "cvmodules.h"
-#include "keyboards.h"
+#include "patchgraph.h"
+#include "presetstate.h"
+#include "realtime.h"
+#include "voicebank.h"
+#include "workerpool.h"
+
+#include <atomic>
+#include <vector>
 
 namespace Steinberg {
 namespace Synth {
@@ -54,13 +61,26 @@ public:
 	tresult PLUGIN_API setBusArrangements (Vst::SpeakerArrangement* inputs, int32 numIns,
 	                                       Vst::SpeakerArrangement* outputs, int32 numOuts) SMTG_OVERRIDE;
 
+	tresult PLUGIN_API canProcessSampleSize (int32 symbolicSampleSize) SMTG_OVERRIDE;
 	tresult PLUGIN_API setupProcessing (Vst::ProcessSetup& setup) SMTG_OVERRIDE;
 	tresult PLUGIN_API setActive (TBool state) SMTG_OVERRIDE;
+	uint32 PLUGIN_API getLatencySamples () SMTG_OVERRIDE;
 	tresult PLUGIN_API process (Vst::ProcessData& data) SMTG_OVERRIDE;
 
 	void readParameterChanges(Vst::IParameterChanges* inputParameterChanges);
+	void applyParameter(Vst::ParamID id, Vst::ParamValue value, int32 rampSamples);
+	void applyOperatorParameter(int32 op, int32 param, Vst::ParamValue value, int32 rampSamples);
+	void applyPitchBend(int32 rampSamples);
+	void applyPendingState();
+	void requestRestart(Vst::IParameterChanges* outputParameterChanges);
+	void processParameterChanges(int32 position, int32 numSamples);
+	void processEvent(Vst::Event& event);
 	void processEvents(Vst::IEventList* inputEvents);
-	void processAudio(Vst::AudioBusBuffers* outputs, int32 numSamples);
+	void renderAudio(Vst::Sample32* out, int32 numSamples);
+	void renderAudio(Vst::Sample64* out, int32 numSamples);
+	template <typename SampleType>
+	void processAudio(Vst::AudioBusBuffers* outputs, int32 numSamples,
+	                  Vst::IEventList* inputEvents);
 
 //------------------------------------------------------------------------
 	tresult PLUGIN_API setState (IBStream* state) SMTG_OVERRIDE;
@@ -72,14 +92,44 @@ public:
 	}
 
 protected:
+	//---the automation of one parameter while the block is rendered------
+	struct ParamCursor
+	{
+		Vst::IParamValueQueue* queue;
+		Vst::ParamID id;
+		int32 point;		// the next point of the queue to reach
+		int32 nextOffset;	// the sample it is reached at
+		bool ramping;		// the parameter is moving towards the point
+	};
+	static const int32 MAX_PARAM_QUEUES = 64;
+
+	void advanceParameter(ParamCursor& cursor, int32 position, int32 numSamples);
+
+	ParamCursor paramCursors[MAX_PARAM_QUEUES];
+	int32 numParamCursors;
+
 	Vst::SampleRate sampleRate;
+	int32 blockSize;
+	std::vector<float> renderBuffer;	// the silent float block of the 64-bit buses, see renderAudio
 
-	FMOperator op1;
-	FMOperator op2;
-	Mixer mixer;
+	FMVoiceBank keyboard;
 	Amplifier amp;
-	//SmoothGate gate;
-	LastMonoKeyboard keyboard;
+	PatchGraph patch;	// amp and everything it pulls, compiled in setActive
+
+	WorkerPool pool;	// renders the voices, started in setActive
+	int32 renderThreads;	// the threads asked for, the audio thread included
+	int32 startedThreads;	// renderThreads at the last activation, the pool may have started fewer
+	int32 oversampling;	// the factor asked for, set in setActive
+	bool restartRequested;	// kParamRestartId was sent since the last activation
+
+	Vst::ParamValue pitchBend;	// normalized, 0.5 is the center
+	int32 pitchBendRange;	// semitones
+
+	// setState runs on another thread than process, it hands the preset to
+	// the audio thread, which applies it at the start of a block
+	TripleBuffer<PresetState> pendingState;
+	// the normalized values last applied or loaded, for getState
+	std::atomic<Vst::ParamValue> paramValues[NUM_PARAMS];
 };
 
 //------------------------------------------------------------------------
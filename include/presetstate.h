@@ -0,0 +1,68 @@
+#ifndef PRESET_STATE
+#define PRESET_STATE
+
+#include <pluginterfaces/base/ibstream.h>
+#include <pluginterfaces/vst/vsttypes.h>
+
+#include "plugids.h"
+
+namespace Steinberg {
+namespace Synth {
+
+//the ids of the parameters follow each other, from op1 level to op6 feedback
+const Vst::ParamID FIRST_PARAM_ID = SynthParams::kParamOp1_levelId;
+const int32 NUM_PARAMS = SynthParams::kParamOp6_feedbackId - FIRST_PARAM_ID + 1;
+
+/** The parameters every operator has, in the order of their ids */
+enum OperatorParam
+{
+    kOpLevel = 0,
+    kOpFrequency,
+    kOpAttack,
+    kOpDecay,
+    kOpSustain,
+    kOpRelease,
+    kOpFeedback,
+
+    kNumOperatorParams
+};
+
+/** Finds the operator and the parameter of an id, false if it is not an
+    operator parameter */
+bool findOperatorParam(Vst::ParamID id, int32& op, int32& param);
+
+//-----------------------------------------------------------------------------
+/** The normalized value of every parameter, the state of the component the
+    host saves with a project or a preset and the processor loads in
+    setState. It is a plain array, the processor hands it to the audio
+    thread by copy, see TripleBuffer.
+    The stream holds a version followed by (id, value) pairs, the ids that
+    are not in a stream keep their defaults and the ids that are not known
+    are skipped, so a state loads in a version with more or fewer
+    parameters. The pitch bend is a performance control, it is not saved. */
+//-----------------------------------------------------------------------------
+struct PresetState
+{
+    Vst::ParamValue values[NUM_PARAMS];
+
+    Vst::ParamValue& operator[](Vst::ParamID id) { return values[id - FIRST_PARAM_ID]; }
+    Vst::ParamValue operator[](Vst::ParamID id) const { return values[id - FIRST_PARAM_ID]; }
+
+    /** The values the processor starts with */
+    void setDefaults();
+
+    /** False if the stream is not a state or ends early. The first versions
+        of the plug-in saved constants that were the defaults, such a state
+        reads as the defaults */
+    bool read(IBStream* stream);
+    bool write(IBStream* stream) const;
+
+    static bool isParam(Vst::ParamID id) { return id >= FIRST_PARAM_ID && id < FIRST_PARAM_ID + NUM_PARAMS; }
+    /** Whether the parameter is part of the state */
+    static bool isSaved(Vst::ParamID id) { return isParam(id) && id != SynthParams::kParamPitchBendId; }
+};
+
+} //namespace Synth
+} //namespace Steinberg
+
+#endif
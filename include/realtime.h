@@ -0,0 +1,97 @@
+#ifndef REALTIME
+#define REALTIME
+
+#include <pluginterfaces/base/ftypes.h>
+
+#include <atomic>
+
+namespace Steinberg {
+namespace Synth {
+
+//-----------------------------------------------------------------------------
+/** Flushes denormal results to zero and reads denormal inputs as zero on the
+    calling thread while it exists, the previous mode is restored after.
+    Decaying values (smoothing, release tails, filter histories) get
+    denormal long before they are 0, and denormal arithmetic is many times
+    slower on most CPUs. The modules never depend on values that small.
+    SSE (FTZ and DAZ in MXCSR) and AArch64 (FZ in FPCR), a no-op elsewhere. */
+//-----------------------------------------------------------------------------
+class DenormalGuard
+{
+    uint64 savedMode;
+public:
+    DenormalGuard();
+    ~DenormalGuard();
+};
+
+//-----------------------------------------------------------------------------
+/** Marks a scope of the calling thread that must not allocate, the scopes
+    can nest. Built with SYNTH_ALLOCATION_GUARD, the global operator new
+    prints the size and aborts when it is called inside such a scope, so an
+    allocation on the audio thread is found the first time it happens and not
+    the first time it blocks. Without it the guard costs nothing. */
+//-----------------------------------------------------------------------------
+class AllocationGuard
+{
+public:
+#ifdef SYNTH_ALLOCATION_GUARD
+    AllocationGuard();
+    ~AllocationGuard();
+    /** Inside a guarded scope of the calling thread */
+    static bool isActive();
+#else
+    AllocationGuard() {}
+    ~AllocationGuard() {}
+    static bool isActive() { return false; }
+#endif
+};
+
+//-----------------------------------------------------------------------------
+/** Hands the latest value of a T from one thread to another without a lock
+    and without allocating. There are three copies: the writer fills one,
+    the reader reads another and the third is the last one published, so
+    neither thread ever waits for the other. A value published before the
+    reader took the previous one replaces it, only the latest is read.
+    One writer thread and one reader thread. */
+//-----------------------------------------------------------------------------
+template <typename T>
+class TripleBuffer
+{
+    static const int32 INDEX = 3;
+    static const int32 FRESH = 4;       //the middle copy was not read yet
+
+    T buffers[3];
+    std::atomic<int32> middle;
+    int32 back;                         //the writer's copy
+    int32 front;                        //the reader's copy
+
+public:
+    TripleBuffer() : middle(1), back(0), front(2) {}
+
+    /** The copy the writer fills, it holds an old value, not the last one
+        published, so it has to be written whole */
+    T& writeBuffer() { return buffers[back]; }
+
+    /** Makes the write buffer the latest value, the writer gets another copy */
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    /** Takes the latest value if one was published since the last call,
+        false otherwise; the reader's thread only */
+    bool consume() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    /** The value taken by consume() */
+    const T& readBuffer() const { return buffers[front]; }
+};
+
+} //namespace Synth
+} //namespace Steinberg
+
+#endif
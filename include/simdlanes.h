@@ -0,0 +1,241 @@
+#ifndef SIMD_LANES
+#define SIMD_LANES
+
+#include <pluginterfaces/vst/vsttypes.h>
+
+#include <cmath>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#define SYNTH_SIMD_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SYNTH_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Steinberg {
+namespace Synth {
+
+//-----------------------------------------------------------------------------
+/** The vector operations the DSP kernels are written with.
+    `simd::Float` holds WIDTH floats: 8 with AVX2 (SYNTH_ENABLE_AVX2), 4 with
+    SSE2 and 1 on other architectures, so the same kernel compiles to each.
+    `simd::Int` holds as many 32 bit integers, the fixed-point phases, which
+    add with wrap around.
+    Comparisons return masks that can only be used with select, mask and any. */
+//-----------------------------------------------------------------------------
+namespace simd {
+
+#if defined(SYNTH_SIMD_AVX2)
+
+typedef __m256 Float;
+typedef __m256i Int;
+const int32 WIDTH = 8;
+
+inline Float set(float x) { return _mm256_set1_ps(x); }
+inline Float load(const float* p) { return _mm256_loadu_ps(p); }
+inline void store(float* p, Float x) { _mm256_storeu_ps(p, x); }
+inline Float ramp() { return _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7); }
+
+inline Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+inline Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+inline Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+inline Float mulAdd(Float a, Float b, Float c) { return _mm256_fmadd_ps(a, b, c); }
+inline Float negMulAdd(Float a, Float b, Float c) { return _mm256_fnmadd_ps(a, b, c); }
+inline Float min(Float a, Float b) { return _mm256_min_ps(a, b); }
+inline Float max(Float a, Float b) { return _mm256_max_ps(a, b); }
+
+inline Float floor(Float x) { return _mm256_floor_ps(x); }
+inline Float round(Float x) {
+    return _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+
+inline Float equal(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+inline Float less(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline Float lessEqual(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+inline Float greaterEqual(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+inline Float maskOr(Float a, Float b) { return _mm256_or_ps(a, b); }
+inline Float maskAnd(Float a, Float b) { return _mm256_and_ps(a, b); }
+
+inline Float select(Float mask, Float a, Float b) { return _mm256_blendv_ps(b, a, mask); }
+inline Float mask(Float mask, Float x) { return _mm256_and_ps(mask, x); }
+inline bool any(Float mask) { return _mm256_movemask_ps(mask) != 0; }
+
+//x is a whole number, the sign of y is flipped where it is odd
+inline Float negateOdd(Float y, Float x) {
+    __m256i sign = _mm256_slli_epi32(_mm256_cvtps_epi32(x), 31);
+    return _mm256_xor_ps(y, _mm256_castsi256_ps(sign));
+}
+
+inline float sum(Float x) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+inline Int setInt(uint32 x) { return _mm256_set1_epi32((int) x); }
+inline Int loadInt(const uint32* p) { return _mm256_loadu_si256((const __m256i*) p); }
+inline void storeInt(uint32* p, Int x) { _mm256_storeu_si256((__m256i*) p, x); }
+inline Int add(Int a, Int b) { return _mm256_add_epi32(a, b); }
+//the integers are signed, out of range floats give 0x80000000
+inline Float toFloat(Int x) { return _mm256_cvtepi32_ps(x); }
+inline Int toInt(Float x) { return _mm256_cvtps_epi32(x); }
+
+#elif defined(SYNTH_SIMD_SSE2)
+
+typedef __m128 Float;
+typedef __m128i Int;
+const int32 WIDTH = 4;
+
+inline Float set(float x) { return _mm_set1_ps(x); }
+inline Float load(const float* p) { return _mm_loadu_ps(p); }
+inline void store(float* p, Float x) { _mm_storeu_ps(p, x); }
+inline Float ramp() { return _mm_setr_ps(0, 1, 2, 3); }
+
+inline Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+inline Float sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+inline Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+inline Float mulAdd(Float a, Float b, Float c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+inline Float negMulAdd(Float a, Float b, Float c) { return _mm_sub_ps(c, _mm_mul_ps(a, b)); }
+inline Float min(Float a, Float b) { return _mm_min_ps(a, b); }
+inline Float max(Float a, Float b) { return _mm_max_ps(a, b); }
+
+//SSE2 has no rounding instruction, the float -> int conversions are used instead
+inline Float floor(Float x) {
+    Float t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), _mm_set1_ps(1.f)));
+}
+inline Float round(Float x) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(x)); }
+
+inline Float equal(Float a, Float b) { return _mm_cmpeq_ps(a, b); }
+inline Float less(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+inline Float lessEqual(Float a, Float b) { return _mm_cmple_ps(a, b); }
+inline Float greaterEqual(Float a, Float b) { return _mm_cmpge_ps(a, b); }
+inline Float maskOr(Float a, Float b) { return _mm_or_ps(a, b); }
+inline Float maskAnd(Float a, Float b) { return _mm_and_ps(a, b); }
+
+inline Float select(Float mask, Float a, Float b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+inline Float mask(Float mask, Float x) { return _mm_and_ps(mask, x); }
+inline bool any(Float mask) { return _mm_movemask_ps(mask) != 0; }
+
+//x is a whole number, the sign of y is flipped where it is odd
+inline Float negateOdd(Float y, Float x) {
+    __m128i sign = _mm_slli_epi32(_mm_cvtps_epi32(x), 31);
+    return _mm_xor_ps(y, _mm_castsi128_ps(sign));
+}
+
+inline float sum(Float x) {
+    Float s = _mm_add_ps(x, _mm_movehl_ps(x, x));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+inline Int setInt(uint32 x) { return _mm_set1_epi32((int) x); }
+inline Int loadInt(const uint32* p) { return _mm_loadu_si128((const __m128i*) p); }
+inline void storeInt(uint32* p, Int x) { _mm_storeu_si128((__m128i*) p, x); }
+inline Int add(Int a, Int b) { return _mm_add_epi32(a, b); }
+//the integers are signed, out of range floats give 0x80000000
+inline Float toFloat(Int x) { return _mm_cvtepi32_ps(x); }
+inline Int toInt(Float x) { return _mm_cvtps_epi32(x); }
+
+#else
+
+//one lane, masks are 0 or 1
+typedef float Float;
+typedef uint32 Int;
+const int32 WIDTH = 1;
+
+inline Float set(float x) { return x; }
+inline Float load(const float* p) { return *p; }
+inline void store(float* p, Float x) { *p = x; }
+inline Float ramp() { return 0; }
+
+inline Float add(Float a, Float b) { return a + b; }
+inline Float sub(Float a, Float b) { return a - b; }
+inline Float mul(Float a, Float b) { return a * b; }
+inline Float mulAdd(Float a, Float b, Float c) { return a * b + c; }
+inline Float negMulAdd(Float a, Float b, Float c) { return c - a * b; }
+inline Float min(Float a, Float b) { return a < b ? a : b; }
+inline Float max(Float a, Float b) { return a > b ? a : b; }
+
+inline Float floor(Float x) { return std::floor(x); }
+inline Float round(Float x) { return std::nearbyint(x); }
+
+inline Float equal(Float a, Float b) { return a == b; }
+inline Float less(Float a, Float b) { return a < b; }
+inline Float lessEqual(Float a, Float b) { return a <= b; }
+inline Float greaterEqual(Float a, Float b) { return a >= b; }
+inline Float maskOr(Float a, Float b) { return a != 0 || b != 0; }
+inline Float maskAnd(Float a, Float b) { return a != 0 && b != 0; }
+
+inline Float select(Float mask, Float a, Float b) { return mask != 0 ? a : b; }
+inline Float mask(Float mask, Float x) { return mask != 0 ? x : 0; }
+inline bool any(Float mask) { return mask != 0; }
+
+inline Float negateOdd(Float y, Float x) { return ((long) x & 1) ? -y : y; }
+
+inline float sum(Float x) { return x; }
+
+inline Int setInt(uint32 x) { return x; }
+inline Int loadInt(const uint32* p) { return *p; }
+inline void storeInt(uint32* p, Int x) { *p = x; }
+inline Int add(Int a, Int b) { return a + b; }
+inline Float toFloat(Int x) { return (float) (int32) x; }
+inline Int toInt(Float x) { return (Int) (int64) std::nearbyint(x); }
+
+#endif
+
+//-----------------------------------------------------------------------------
+// The argument is reduced to r = x - k * pi with r in [-pi/2, pi/2],
+// then sin(x) = (-1)^k * sin(r) and sin(r) is an odd polynomial of degree 9.
+// The coefficients are the minimax (Remez) fit of sin(r) on [-pi/2, pi/2]
+// with r as the first term, rounded to float one by one from the r^3 term
+// and refitted, the error of the fit is 5e-9, below the float rounding.
+// pi is split in two parts so that the reduction stays exact for large FM
+// indices. The error is below 2e-7 in the whole range used by the synth.
+//-----------------------------------------------------------------------------
+const float TWO_PI = 6.28318530717958647692f;
+const float INV_TWO_PI = 0.15915494309189533577f;
+const float INV_PI = 0.31830988618379067154f;
+const float PI_HI = 3.140625f;
+const float PI_LO = 9.67653589793e-4f;
+
+inline Float sin(Float x) {
+    Float k = round(mul(x, set(INV_PI)));
+    Float r = negMulAdd(k, set(PI_HI), x);
+    r = negMulAdd(k, set(PI_LO), r);
+
+    Float r2 = mul(r, r);
+    Float p = set(2.599344725e-6f);
+    p = mulAdd(p, r2, set(-1.980622910e-4f));
+    p = mulAdd(p, r2, set(8.333010599e-3f));
+    p = mulAdd(p, r2, set(-1.666665673e-1f));
+    p = mulAdd(mul(p, r2), r, r);
+
+    return negateOdd(p, k);
+}
+
+//-----------------------------------------------------------------------------
+// The fixed-point phases, 2^32 is one period (see Phase in sinekernels.h)
+//-----------------------------------------------------------------------------
+const float PHASE_TO_RADIANS = 1.46291807926715968e-9f;    //2pi / 2^32
+const float PHASE_PER_CYCLE = 4294967296.f;
+
+/** The phase in radians, in [-pi, pi) */
+inline Float phaseToRadians(Int phase) { return mul(toFloat(phase), set(PHASE_TO_RADIANS)); }
+
+/** The increment of `cycles` periods per sample, the whole periods are dropped,
+    the fraction left is in [-0.5, 0.5] and 0.5 becomes 0x80000000 like -0.5 */
+inline Int cyclesToPhase(Float cycles) {
+    return toInt(mul(sub(cycles, round(cycles)), set(PHASE_PER_CYCLE)));
+}
+
+} //namespace simd
+
+} //namespace Synth
+} //namespace Steinberg
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef SINE_KERNELS
+#define SINE_KERNELS
+
+#include <pluginterfaces/vst/vsttypes.h>
+
+namespace Steinberg {
+namespace Synth {
+
+//-----------------------------------------------------------------------------
+/** The ways the oscillators can evaluate the sine, from the cheapest to the
+    most accurate (see doc/sine-tiers.md for the measured error and cost) */
+//-----------------------------------------------------------------------------
+enum SineQuality
+{
+    kSineTable = 0,         //linearly interpolated lookup table
+    kSinePolynomial,        //vectorized polynomial
+    kSineExact,             //libm sin
+
+    kNumSineQualities
+};
+
+//the build can choose the quality the oscillators start with
+#ifndef SYNTH_DEFAULT_SINE_QUALITY
+#define SYNTH_DEFAULT_SINE_QUALITY kSinePolynomial
+#endif
+
+//-----------------------------------------------------------------------------
+/** The phase of an oscillator as a fixed-point fraction of the period, 2^32
+    is one period. Adding the increment wraps through the integer overflow,
+    so the phase never needs fmod, and a constant increment is an exact
+    frequency: the phase does not drift however long the render is. */
+//-----------------------------------------------------------------------------
+typedef uint32 Phase;
+
+const float PHASE_TO_RADIANS = 1.46291807926715968e-9f;    //2pi / 2^32
+
+/** The phase in radians, in [-pi, pi) */
+inline float phaseToRadians(Phase phase) { return (float) (int32) phase * PHASE_TO_RADIANS; }
+
+/** The increment of `cycles` periods per sample (frequency / sample rate),
+    rounded to 2^-32 of a period, the whole periods are dropped */
+Phase cyclesToPhase(double cycles);
+
+//-----------------------------------------------------------------------------
+/** Block kernels evaluating the sine for the oscillators.
+    The polynomial is vectorized with SSE2 (4 samples at a time) or, when the
+    plugin is built with SYNTH_ENABLE_AVX2, with AVX2 (8 samples at a time).
+    On other architectures a scalar version of the same code is used. */
+//-----------------------------------------------------------------------------
+
+/** sin(x) for any x, computed with the same polynomial as the block kernels */
+float fastSin(float x);
+
+/** sin(x) for any x, interpolated from the lookup table */
+float tableSin(float x);
+
+/** Advances `phase` by `increment` for every sample and writes sin(phase)
+    to `out` */
+void sineBlock(float* out, Phase* phase, Phase increment, int32 numSamples,
+               SineQuality quality = kSinePolynomial);
+
+/** Like sineBlock, but writes sin(phase + mod[i]), this is the FM case,
+    `mod` is in radians. `mod` can be the same buffer as `out` */
+void fmSineBlock(float* out, Phase* phase, Phase increment, const float* mod, int32 numSamples,
+                 SineQuality quality = kSinePolynomial);
+
+/** Like fmSineBlock, for an oscillator whose frequency is moving: the
+    increment of sample i is frequency[i] * scale periods, scale is the
+    key divided by the sample rate. `mod` can be nullptr */
+void sweepBlock(float* out, Phase* phase, const float* frequency, float scale, const float* mod,
+                int32 numSamples, SineQuality quality = kSinePolynomial);
+
+} //namespace Synth
+} //namespace Steinberg
+
+#endif
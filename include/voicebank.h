@@ -0,0 +1,171 @@
+#ifndef VOICE_BANK
+#define VOICE_BANK
+
+#include "decimator.h"
+#include "fmalgorithms.h"
+#include "keyboards.h"
+#include "paramramp.h"
+#include "simdlanes.h"
+#include "workerpool.h"
+
+#include <utility>
+#include <vector>
+
+namespace Steinberg {
+namespace Synth {
+
+//-----------------------------------------------------------------------------
+/** A polyphonic keyboard of FM voices of up to 6 operators, each with a
+    LinearADSR envelope and a feedback, wired by one of FM_ALGORITHMS. The
+    first algorithm is the 2 operator patch (op1 modulating op2).
+    There are no module objects: every algorithm is compiled into its own
+    render loop, in which the operators are unrolled and the modulations
+    are fixed, so only the operators of the algorithm are rendered.
+    The state of every voice is kept in arrays with one entry per voice, so
+    that simd::WIDTH voices (8 with AVX2, 4 with SSE2) are rendered by every
+    vector instruction. Groups of voices that are all off are skipped.
+    With a WorkerPool the groups that are on are rendered in parallel, every
+    thread into its own lanes, which are summed in thread order.
+    The oscillators can run at 2, 4 or 8 times the sample rate, so that deep
+    modulation does not alias, the sum of the voices is then decimated.
+    For the 64-bit buses the same kernels add the voices into double lanes,
+    which are summed and decimated in double.
+    The pitch bend is a ratio applied to all voices, it is folded into the
+    increments, and into the frequencies rendered per sample while it moves. */
+//-----------------------------------------------------------------------------
+class FMVoiceBank : public PolyKeyboard, public ParallelJob
+{
+public:
+    static const int32 NUM_OPERATORS = MAX_FM_OPERATORS;
+
+private:
+    //parameters, one per operator
+    ParamRamp baseFreq[NUM_OPERATORS];
+    ParamRamp volume[NUM_OPERATORS];
+    float attackLevel[NUM_OPERATORS];
+    float decayLevel[NUM_OPERATORS];
+    float sustainLevel[NUM_OPERATORS];
+    float releaseLevel[NUM_OPERATORS];
+    float decayIncrement[NUM_OPERATORS];
+    float feedback[NUM_OPERATORS];      //half the feedback in radians, it scales the sum of the last two outputs
+    int32 algorithm;                    //an index of FM_ALGORITHMS
+    SineQuality sineQuality;
+    ParamRamp bend;         //the pitch bend, a ratio of the frequency of every key
+
+    //state, one row per operator and one column per voice
+    float keyMod[MAX_POLYPHONY];
+    Phase phase[NUM_OPERATORS][MAX_POLYPHONY];
+    Phase increment[NUM_OPERATORS][MAX_POLYPHONY];
+    float envValue[NUM_OPERATORS][MAX_POLYPHONY];
+    float envStage[NUM_OPERATORS][MAX_POLYPHONY];   //the phases of LinearADSR, as floats for the lanes
+    float attackIncrement[NUM_OPERATORS][MAX_POLYPHONY];
+    float releaseIncrement[NUM_OPERATORS][MAX_POLYPHONY];
+    float lastOutput[NUM_OPERATORS][MAX_POLYPHONY];     //the feedback
+    float previousOutput[NUM_OPERATORS][MAX_POLYPHONY];
+
+    //the values of the moving parameters for the block being rendered,
+    //nullptr for the settled ones
+    const float* frequencyRamp[NUM_OPERATORS];
+    const float* volumeRamp[NUM_OPERATORS];
+    std::vector<float> bentFrequency;   //maxSamples per operator, the frequencies times the bend
+
+    //the sum of the voices in float or in double
+    template <typename Sample>
+    struct Mix
+    {
+        //simd::WIDTH samples per oversampled sample for every thread of the
+        //pool, the lanes are summed at the end of the block
+        std::vector<Sample> lanes;
+        std::vector<Sample> oversampled;        //the sum of the lanes before the decimator
+        Decimator<Sample> decimator;
+    };
+    Mix<float> mix32;
+    Mix<double> mix64;                          //only allocated with setDoublePrecision(true)
+    bool doublePrecision;
+    bool renderingDoubles;                      //the block being rendered goes to mix64
+    int32 maxSamples;
+    int32 oversampling;
+    int32 decimatorTail;                        //output samples the decimator still holds of the last voices
+    char threadUsed[WorkerPool::MAX_THREADS];   //the lanes of the thread were cleared in this block
+
+    WorkerPool* pool;
+    int32 activeGroups[MAX_POLYPHONY];          //the first voice of every group rendered in this block
+    int32 renderSamples;
+
+    void setIncrement(int32 op, int32 voice);
+    void setDecayIncrement(int32 op);
+    void resizeLanes();
+    void setupDecimators();
+    bool isGroupOn(int32 first);         //a carrier of a voice of the group is on
+
+    Mix<float>& getMix(float*) { return mix32; }
+    Mix<double>& getMix(double*) { return mix64; }
+    template <typename Sample>
+    void render(Sample* out, int32 numSamples);
+    template <typename Sample>
+    void renderTask(int32 task, int32 thread);
+
+    template <int32 alg, SineQuality quality, int32 factor, typename Sample>
+    void renderGroup(int32 first, int32 numSamples, Sample* lanes);
+    //calls the renderGroup of the current algorithm and oversampling
+    template <SineQuality quality, typename Sample, int32... algs>
+    void renderAlgorithm(int32 first, int32 numSamples, Sample* lanes,
+                         std::integer_sequence<int32, algs...>);
+
+protected:
+    virtual bool isVoiceOn(int32 voice);
+    virtual float getVoiceLevel(int32 voice);
+    virtual void startVoice(int32 voice, int16* pitch);
+    virtual void releaseVoice(int32 voice);
+
+public:
+    FMVoiceBank();
+    virtual void setSampleRate(Vst::SampleRate* _sampleRate);
+    virtual void setBlockSize(int32 maxSamples);
+    /** Also on while the decimator lets out the end of the last voices */
+    virtual bool isOn();
+    virtual float output();
+    virtual void process(float* out, int32 numSamples);
+    /** The same block for a 64-bit bus, needs setDoublePrecision(true) */
+    void process(double* out, int32 numSamples);
+    /** No voice is rendered, the pitch bend, the frequencies and the volumes
+        move on so they do not glide from where they stopped at the next note */
+    virtual void skip(int32 numSamples);
+    virtual void runTask(int32 task, int32 thread);
+
+    /** The pool renders the voices from now on, nullptr renders them on the
+        calling thread, not to be called while a block is rendered */
+    virtual void setWorkerPool(WorkerPool* _pool);
+
+    /** 1, 2, 4 or 8, allocates like setBlockSize() */
+    virtual void setOversampling(int32 factor);
+    int32 getOversampling() { return oversampling; }
+    /** The delay of the decimator in samples */
+    float getLatency() { return mix32.decimator.getLatency(); }
+    /** Whether the blocks are rendered for 64-bit buses, allocates the
+        double lanes and decimator like setBlockSize() */
+    void setDoublePrecision(bool doubles);
+
+    virtual void setOperatorVolume(int32 op, Vst::ParamValue* volume);
+    virtual void setOperatorFrequency(int32 op, Vst::ParamValue* freq);
+    virtual void rampOperatorVolume(int32 op, Vst::ParamValue* _volume, int32 numSamples);
+    virtual void rampOperatorFrequency(int32 op, Vst::ParamValue* freq, int32 numSamples);
+    virtual void setVolumeSmoothing(SmoothingMode mode, float seconds);
+    virtual void setFrequencySmoothing(SmoothingMode mode, float seconds);
+    virtual void setOperatorAttack(int32 op, Vst::ParamValue* _value);
+    virtual void setOperatorDecay(int32 op, Vst::ParamValue* _value);
+    virtual void setOperatorSustain(int32 op, Vst::ParamValue* _value);
+    virtual void setOperatorRelease(int32 op, Vst::ParamValue* _value);
+    /** The phase modulation of the operator by itself, in radians */
+    virtual void setOperatorFeedback(int32 op, Vst::ParamValue* _value);
+    /** An index of FM_ALGORITHMS, the voices keep playing with the new wiring */
+    virtual void setAlgorithm(int32 index);
+    int32 getAlgorithm() { return algorithm; }
+    virtual void setSineQuality(SineQuality quality);
+    virtual void rampPitchBend(Vst::ParamValue* ratio, int32 numSamples);
+};
+
+} //namespace Synth
+} //namespace Steinberg
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef WORKER_POOL
+#define WORKER_POOL
+
+#include <pluginterfaces/base/ftypes.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace Steinberg {
+namespace Synth {
+
+//-----------------------------------------------------------------------------
+/** Work split into tasks that can run on any thread of a WorkerPool,
+    `thread` is 0 for the thread calling WorkerPool::run() */
+//-----------------------------------------------------------------------------
+class ParallelJob
+{
+public:
+    virtual void runTask(int32 task, int32 thread)=0;
+};
+
+//-----------------------------------------------------------------------------
+/** A fixed set of worker threads for the audio thread.
+    The threads are created by start() and destroyed by stop(), which must
+    not be called from the audio thread. run() hands the tasks out to one
+    lock-free work-stealing deque per thread and takes part in the work
+    itself, it neither allocates nor locks.
+    Idle workers spin, then yield, then sleep for a growing but bounded
+    time. A worker that is late finds its tasks stolen, so a block never
+    waits for a sleeping worker, and a pool without workers (none requested
+    or none could be created) runs all the tasks on the calling thread. */
+//-----------------------------------------------------------------------------
+class WorkerPool
+{
+public:
+    static const int32 MAX_THREADS = 8;     //the audio thread included
+
+private:
+    //---a Chase-Lev deque: the owner pops from the bottom, the others steal
+    //from the top, the tasks are pushed while no job is running
+    struct alignas(64) TaskDeque
+    {
+        std::atomic<int32> top;
+        std::atomic<int32> bottom;
+        std::vector<int32> tasks;
+        int32 mask;
+
+        void reset(int32 capacity);
+        void push(int32 task);
+        int32 pop();            //-1 if empty
+        int32 steal();          //-1 if empty or lost to another thief
+    };
+
+    std::vector<std::thread> workers;
+    std::unique_ptr<TaskDeque[]> deques;    //one per thread, deque 0 is the audio thread's
+    int32 numThreads;
+
+    ParallelJob* job;
+    std::atomic<uint32> generation;         //incremented for every job
+    std::atomic<bool> open;                 //workers may join the current job
+    std::atomic<int32> remaining;           //tasks not finished yet
+    std::atomic<int32> busyWorkers;         //workers inside the current job
+    std::atomic<bool> quit;
+
+    void workerLoop(int32 thread);
+    void work(int32 thread);
+    int32 findTask(int32 thread);
+
+public:
+    WorkerPool();
+    ~WorkerPool();
+
+    /** Creates up to `numWorkers` threads for jobs of up to `maxTasks` tasks,
+        returns false if not all of them could be created */
+    bool start(int32 numWorkers, int32 maxTasks);
+    void stop();
+
+    int32 getNumWorkers() { return numThreads - 1; }
+    int32 getNumThreads() { return numThreads; }
+
+    /** Runs tasks 0 .. numTasks - 1 of the job, returns when all are done */
+    void run(ParallelJob* _job, int32 numTasks);
+};
+
+} //namespace Synth
+} //namespace Steinberg
+
+#endif
@@ -1,5 +1,8 @@
 #include "../include/cvmodules.h"
+#include "../include/simdlanes.h"
+#include "../include/sinekernels.h"
 
+#include <algorithm>
 #include <cmath>
 
 namespace Steinberg {
@@ -7,10 +10,119 @@ namespace Synth {
 
 NullModule NULL_MODULE;
 
+namespace {
+
+//the exponential attack aims this far above 1, the lower, the more curved it is
+const float ATTACK_TARGET = 1.3f;
+
+//-----------------------------------------------------------------------------
+// The stages of the envelopes are linear segments. In blocks a segment is
+// rendered in closed form, out[i] = value + (i + 1) * increment, so the
+// stages only branch where a segment ends, not for every sample.
+//-----------------------------------------------------------------------------
+
+/** The number of samples a ramp from `from` by `increment` renders before it
+    reaches `to` (`from` has not reached it yet), at most numSamples */
+int32 rampLength(float from, float to, float increment, int32 numSamples) {
+    float steps = (to - from) / increment;
+    //a ramp that does not move towards `to` runs to the end of the block
+    if (steps < 0 || !(steps < numSamples)) {
+        return numSamples;
+    }
+    return std::max((int32) std::ceil(steps), 1);
+}
+
+/** Renders the ramp of `value` towards `target` until it reaches it or the
+    block ends, the last sample is the new value. Returns the samples rendered */
+int32 rampSegment(float* out, float& value, float target, float increment, int32 numSamples) {
+    int32 length = rampLength(value, target, increment, numSamples);
+
+    const simd::Float base = simd::set(value);
+    const simd::Float inc = simd::set(increment);
+    simd::Float index = simd::add(simd::ramp(), simd::set(1));
+    int32 i = 0;
+    for (; i + simd::WIDTH <= length; i += simd::WIDTH) {
+        simd::store(out + i, simd::mulAdd(index, inc, base));
+        index = simd::add(index, simd::set((float) simd::WIDTH));
+    }
+    for (; i < length; i++) {
+        out[i] = value + (i + 1) * increment;
+    }
+    value = out[length - 1];
+    return length;
+}
+
+/** Renders the curve of `value` towards `target`, value = target + (value - target) * coefficient^n,
+    until it passes `end` or the block ends. The sample that passes `end` is
+    rendered as `settle`, the value the stage ends on. Returns the samples rendered */
+int32 curveSegment(float* out, float& value, float target, float end, float settle, float coefficient,
+                   int32 numSamples, bool* ended) {
+    float distance = value - target;
+    //the curve passes `end` at the first n where coefficient^n <= ratio
+    float ratio = (end - target) / distance;
+    int32 length = numSamples;
+    *ended = true;
+    if (!(ratio > 0 && ratio < 1) || coefficient <= 0) {
+        //`value` is already past `end`, or gets there in one step
+        length = 1;
+    }
+    else if (coefficient >= 1) {
+        *ended = false;
+    }
+    else {
+        float steps = std::log(ratio) / std::log(coefficient);
+        if (steps < numSamples) {
+            length = std::max((int32) std::ceil(steps), 1);
+        }
+        else {
+            *ended = false;
+        }
+    }
+
+    //the vector loop renders WIDTH powers of the coefficient at once
+    float powers[simd::WIDTH];
+    float power = 1;
+    for (int32 k = 0; k < simd::WIDTH; k++) {
+        power *= coefficient;
+        powers[k] = power;
+    }
+    const simd::Float curve = simd::load(powers);
+    const simd::Float base = simd::set(target);
+    int32 i = 0;
+    for (; i + simd::WIDTH <= length; i += simd::WIDTH) {
+        simd::store(out + i, simd::mulAdd(curve, simd::set(distance), base));
+        distance *= power;
+    }
+    for (; i < length; i++) {
+        distance *= coefficient;
+        out[i] = target + distance;
+    }
+
+    if (*ended) {
+        out[length - 1] = settle;
+    }
+    value = out[length - 1];
+    return length;
+}
+
+} //namespace
+
+//-----------------------------------------------------------------------------
+void CVModule::process(float* out, int32 numSamples) {
+    for (int32 i = 0; i < numSamples; i++) {
+        out[i] = output();
+    }
+}
+
+void CVModule::processInputs(float* out, const float* const* inputs, int32 numSamples) {
+    process(out, numSamples);
+}
+
 //-----------------------------------------------------------------------------
-Camertone::Camertone() : period(2 * M_PI) {
+Camertone::Camertone() {
     increment = 0;
     phase = 0; 
+    sineQuality = SYNTH_DEFAULT_SINE_QUALITY;
 }
 
 void Camertone::setSampleRate(Vst::SampleRate* _sampleRate) {
@@ -19,54 +131,117 @@ void Camertone::setSampleRate(Vst::SampleRate* _sampleRate) {
 }
 
 void Camertone::setIncrement() {
-    increment = period * 440 / sampleRate;
+    increment = cyclesToPhase(440.0 / sampleRate);
 }
 
 float Camertone::output() {
-    phase = std::fmod(phase + increment, period);
-    return sin(phase);
+    phase += increment;
+    return sin(phaseToRadians(phase));
 }
 
+void Camertone::process(float* out, int32 numSamples) {
+    sineBlock(out, &phase, increment, numSamples, sineQuality);
+}
+
+void Camertone::setSineQuality(SineQuality quality) { sineQuality = quality; }
+
 
 
 //-----------------------------------------------------------------------------
 float NullModule::output() {
     return 0;
 }
+
+void NullModule::process(float* out, int32 numSamples) {
+    std::fill(out, out + numSamples, 0.f);
+}
 //-----------------------------------------------------------------------------
 
 
 
 //-----------------------------------------------------------------------------
-Oscillator::Oscillator() : period(2 * M_PI) {
+Oscillator::Oscillator() {
     increment = 0;
     phase = 0;
-    baseFreq = 440;
+    baseFreq.setValue(440);
+    baseFreq.setSmoothing(kSmoothLinear, DEFAULT_FREQUENCY_SMOOTHING);
     keyMod = 1;
+    sineQuality = SYNTH_DEFAULT_SINE_QUALITY;
 }
 
 void Oscillator::setSampleRate(Vst::SampleRate* _sampleRate) {
     CVModule::setSampleRate(_sampleRate);
+    baseFreq.setSampleRate(_sampleRate);
     setIncrement();
 }
 
+void Oscillator::setBlockSize(int32 maxSamples) {
+    baseFreq.setBlockSize(maxSamples);
+}
+
 void Oscillator::setFrequency(Vst::ParamValue* freq) {
-    baseFreq = *freq;
+    baseFreq.setTarget(*freq);
+    setIncrement();
+}
+
+void Oscillator::rampFrequency(Vst::ParamValue* freq, int32 numSamples) {
+    baseFreq.rampTo(*freq, numSamples);
     setIncrement();
 }
 
+void Oscillator::setFrequencySmoothing(SmoothingMode mode, float seconds) {
+    baseFreq.setSmoothing(mode, seconds);
+}
+
 void Oscillator::setKeyMod(float mod) {
     keyMod = mod;
     setIncrement();
 }
 
+void Oscillator::setSineQuality(SineQuality quality) { sineQuality = quality; }
+
+//while the frequency is moving the increment is recomputed every sample
+//or taken by sweepBlock from the ramp
 void Oscillator::setIncrement() {
-    increment = period * keyMod * baseFreq / sampleRate;
+    increment = cyclesToPhase((double) keyMod * baseFreq.getValue() / sampleRate);
 }
 
 float Oscillator::output() {
-    phase = std::fmod(phase + increment, period);
-    return sin(phase);
+    if (!baseFreq.isSettled()) {
+        baseFreq.next();
+        setIncrement();
+    }
+    phase += increment;
+    return sin(phaseToRadians(phase));
+}
+
+float Oscillator::outputFM(float mod) {
+    if (!baseFreq.isSettled()) {
+        baseFreq.next();
+        setIncrement();
+    }
+    phase += increment;
+    return sin(phaseToRadians(phase) + mod);
+}
+
+void Oscillator::processFM(float* out, const float* mod, int32 numSamples) {
+    if (baseFreq.isSettled()) {
+        fmSineBlock(out, &phase, increment, mod, numSamples, sineQuality);
+        return;
+    }
+    sweepBlock(out, &phase, baseFreq.render(numSamples), keyMod / sampleRate,
+               mod, numSamples, sineQuality);
+    setIncrement();
+}
+
+void Oscillator::process(float* out, int32 numSamples) {
+    if (baseFreq.isSettled()) {
+        sineBlock(out, &phase, increment, numSamples, sineQuality);
+        return;
+    }
+    sweepBlock(out, &phase, baseFreq.render(numSamples), keyMod / sampleRate, nullptr,
+               numSamples, sineQuality);
+    setIncrement();
 }
 
 
@@ -78,27 +253,98 @@ OneInputOneOutputModule::OneInputOneOutputModule() {
 
 float OneInputOneOutputModule::output() { return input->output(); }
 
+void OneInputOneOutputModule::process(float* out, int32 numSamples) {
+    input->process(out, numSamples);
+}
+
 void OneInputOneOutputModule::setInput(CVModule* _input) { input = _input; }
 
 bool OneInputOneOutputModule::isOn() { return input->isOn(); }
 
+int32 OneInputOneOutputModule::getNumInputs() { return 1; }
+
+CVModule* OneInputOneOutputModule::getInput(int32 index) { return input; }
+
+bool OneInputOneOutputModule::forwardsInput() { return true; }
+
 
 
 //-----------------------------------------------------------------------------
 Amplifier::Amplifier() {
-    volume = 1;
+    volume.setValue(1);
+    volume.setSmoothing(kSmoothOnePole, DEFAULT_VOLUME_SMOOTHING);
+}
+
+void Amplifier::setSampleRate(Vst::SampleRate* _sampleRate) {
+    CVModule::setSampleRate(_sampleRate);
+    volume.setSampleRate(_sampleRate);
+}
+
+void Amplifier::setBlockSize(int32 maxSamples) {
+    volume.setBlockSize(maxSamples);
 }
 
 float Amplifier::output() {
     if (isOn()) {
-        return volume * input->output();
+        return volume.next() * input->output();
     }
+    volume.skip(1);
     return 0;
 }
 
-void Amplifier::setVolume(Vst::ParamValue* _volume) { volume = *_volume; }
+void Amplifier::process(float* out, int32 numSamples) {
+    if (!isOn()) {
+        volume.skip(numSamples);
+        std::fill(out, out + numSamples, 0.f);
+        return;
+    }
+    input->process(out, numSamples);
+    applyVolume(out, out, numSamples);
+}
+
+void Amplifier::amplify(double* out, const double* in, int32 numSamples) {
+    applyVolume(out, in, numSamples);
+}
+
+template <typename Sample>
+void Amplifier::applyVolume(Sample* out, const Sample* in, int32 numSamples) {
+    if (volume.isSettled()) {
+        const Sample gain = volume.getValue();
+        for (int32 i = 0; i < numSamples; i++) {
+            out[i] = in[i] * gain;
+        }
+        return;
+    }
+    const float* gain = volume.render(numSamples);
+    for (int32 i = 0; i < numSamples; i++) {
+        out[i] = in[i] * gain[i];
+    }
+}
+
+void Amplifier::setVolume(Vst::ParamValue* _volume) { volume.setTarget(*_volume); }
 
-bool Amplifier::isOn() { return volume > 0 && input->isOn(); }
+void Amplifier::rampVolume(Vst::ParamValue* _volume, int32 numSamples) {
+    volume.rampTo(*_volume, numSamples);
+}
+
+void Amplifier::setVolumeSmoothing(SmoothingMode mode, float seconds) {
+    volume.setSmoothing(mode, seconds);
+}
+
+bool Amplifier::isOn() { return !volume.isSilent() && input->isOn(); }
+
+bool Amplifier::forwardsInput() { return false; }
+
+bool Amplifier::pullsInputs() { return isOn(); }
+
+void Amplifier::processInputs(float* out, const float* const* inputs, int32 numSamples) {
+    if (!inputs) {
+        volume.skip(numSamples);
+        std::fill(out, out + numSamples, 0.f);
+        return;
+    }
+    applyVolume(out, inputs[0], numSamples);
+}
 
 
 
@@ -107,6 +353,10 @@ ModOnlyAmp::ModOnlyAmp() {
     modulator = (CVModule*) &NULL_MODULE;
 }
 
+void ModOnlyAmp::setBlockSize(int32 maxSamples) {
+    modBuffer.resize(maxSamples);
+}
+
 bool ModOnlyAmp::isOn() {
     return modulator->isOn() || modulator == &NULL_MODULE;
 }
@@ -118,29 +368,111 @@ float ModOnlyAmp::output() {
     return 0;
 }
 
+void ModOnlyAmp::process(float* out, int32 numSamples) {
+    if (!isOn()) {
+        std::fill(out, out + numSamples, 0.f);
+        return;
+    }
+    modulator->process(modBuffer.data(), numSamples);
+    input->process(out, numSamples);
+    for (int32 i = 0; i < numSamples; i++) {
+        out[i] *= modBuffer[i];
+    }
+}
+
 void ModOnlyAmp::setModulator(CVModule* mod) {
     modulator = mod;
 }
 
+int32 ModOnlyAmp::getNumInputs() { return 2; }
+
+CVModule* ModOnlyAmp::getInput(int32 index) { return index == 0 ? modulator : input; }
+
+bool ModOnlyAmp::forwardsInput() { return false; }
+
+bool ModOnlyAmp::pullsInputs() { return isOn(); }
+
+void ModOnlyAmp::processInputs(float* out, const float* const* inputs, int32 numSamples) {
+    if (!inputs) {
+        std::fill(out, out + numSamples, 0.f);
+        return;
+    }
+    for (int32 i = 0; i < numSamples; i++) {
+        out[i] = inputs[1][i] * inputs[0][i];
+    }
+}
+
 
 
 //-----------------------------------------------------------------------------
+void ModAmp::setBlockSize(int32 maxSamples) {
+    Amplifier::setBlockSize(maxSamples);
+    ModOnlyAmp::setBlockSize(maxSamples);
+}
+
 bool ModAmp::isOn() {
-    return volume > 0 && (modulator->isOn() || modulator == &NULL_MODULE);
+    return !volume.isSilent() && (modulator->isOn() || modulator == &NULL_MODULE);
 }
 
 float ModAmp::output() {
     if (isOn()) {
-        return volume * modulator->output() * input->output();    
+        return volume.next() * modulator->output() * input->output();    
     }
+    volume.skip(1);
     return 0;
 }
 
+void ModAmp::process(float* out, int32 numSamples) {
+    if (!isOn()) {
+        volume.skip(numSamples);
+        std::fill(out, out + numSamples, 0.f);
+        return;
+    }
+    modulator->process(modBuffer.data(), numSamples);
+    input->process(out, numSamples);
+    applyModulation(out, out, modBuffer.data(), numSamples);
+}
+
+void ModAmp::applyModulation(float* out, const float* in, const float* mod, int32 numSamples) {
+    if (volume.isSettled()) {
+        const float gain = volume.getValue();
+        for (int32 i = 0; i < numSamples; i++) {
+            out[i] = in[i] * (gain * mod[i]);
+        }
+        return;
+    }
+    const float* gain = volume.render(numSamples);
+    for (int32 i = 0; i < numSamples; i++) {
+        out[i] = in[i] * (gain[i] * mod[i]);
+    }
+}
+
+int32 ModAmp::getNumInputs() { return ModOnlyAmp::getNumInputs(); }
+
+CVModule* ModAmp::getInput(int32 index) { return ModOnlyAmp::getInput(index); }
+
+bool ModAmp::forwardsInput() { return false; }
+
+bool ModAmp::pullsInputs() { return isOn(); }
+
+void ModAmp::processInputs(float* out, const float* const* inputs, int32 numSamples) {
+    if (!inputs) {
+        volume.skip(numSamples);
+        std::fill(out, out + numSamples, 0.f);
+        return;
+    }
+    applyModulation(out, inputs[1], inputs[0], numSamples);
+}
+
 
 
 //-----------------------------------------------------------------------------
 float Gate::output() { return on; }
 
+void Gate::process(float* out, int32 numSamples) {
+    std::fill(out, out + numSamples, on ? 1.f : 0.f);
+}
+
 bool Gate::isOn() { return on; }
 
 void Gate::press() { on = true; }
@@ -197,6 +529,42 @@ float SmoothGate::output() {
     return value;
 }
 
+//the same stages as output(), the sample where a ramp ends is rendered alone
+int32 SmoothGate::renderSegment(float* out, int32 numSamples) {
+    switch (phase) 
+    {
+    case 1:
+        if (value >= 1) {
+            phase = 2;
+            value = 1;
+            break;
+        }
+        return rampSegment(out, value, 1, increment, numSamples);
+    case 2:
+        std::fill(out, out + numSamples, 1.f);
+        return numSamples;
+    case 3:
+        if (value <= 0) {
+            phase = 0;
+            value = 0;
+            break;
+        }
+        return rampSegment(out, value, 0, -increment, numSamples);
+    default:
+        std::fill(out, out + numSamples, value);
+        return numSamples;
+    }
+    out[0] = value;
+    return 1;
+}
+
+void SmoothGate::process(float* out, int32 numSamples) {
+    int32 i = 0;
+    while (i < numSamples) {
+        i += renderSegment(out + i, numSamples - i);
+    }
+}
+
 
 
 //-----------------------------------------------------------------------------
@@ -255,6 +623,8 @@ void LinearADSR::setRelease(Vst::ParamValue* _value) {
 
 bool LinearADSR::isOn() { return phase != 0; }
 
+float LinearADSR::getValue() { return value; }
+
 void LinearADSR::press() { phase = 1; }
 void LinearADSR::release() {
     phase = 4;
@@ -302,6 +672,212 @@ float LinearADSR::output() {
     return value;
 }
 
+//the same stages as output(), the sample where a ramp ends is rendered alone
+int32 LinearADSR::renderSegment(float* out, int32 numSamples) {
+    switch (phase) 
+    {
+    case 1:
+        //Attack
+        if (value >= 1) {
+            phase++;
+            value = 1;
+            break;
+        }
+        return rampSegment(out, value, 1, attackIncrement, numSamples);
+    case 2:
+        //Decay
+        if (value <= sustainLevel) {
+            phase++;
+            value = sustainLevel;
+            break;
+        }
+        return rampSegment(out, value, sustainLevel, decayIncrement, numSamples);
+    case 3:
+        //Sustain
+        std::fill(out, out + numSamples, sustainLevel);
+        return numSamples;
+    case 4:
+        //Release
+        if (value <= 0) {
+            phase = 0;
+            value = 0;
+            break;
+        }
+        return rampSegment(out, value, 0, releaseIncrement, numSamples);
+    default:
+        //envelope is off
+        std::fill(out, out + numSamples, value);
+        return numSamples;
+    }
+    out[0] = value;
+    return 1;
+}
+
+void LinearADSR::process(float* out, int32 numSamples) {
+    int32 i = 0;
+    while (i < numSamples) {
+        i += renderSegment(out + i, numSamples - i);
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+const float ExponentialADSR::DEFAULT_THRESHOLD = 1e-4f;
+
+ExponentialADSR::ExponentialADSR() {
+    value = 0;
+    phase = 0;
+    threshold = DEFAULT_THRESHOLD;
+}
+
+void ExponentialADSR::setSampleRate(Vst::SampleRate* _sampleRate) {
+    sampleRate = *_sampleRate;
+    Vst::ParamValue val = 0.005;
+    setAttack(&val);
+    setRelease(&val);
+    setDecay(&val);
+    val = 1;
+    setSustain(&val);
+}
+
+
+
+//a stage of no time still takes one sample
+void ExponentialADSR::setAttackCoefficient() {
+    double samples = std::max(attackLevel * sampleRate, 1.0);
+    attackCoefficient = (float) std::pow((ATTACK_TARGET - 1) / ATTACK_TARGET, 1 / samples);
+    attackOffset = ATTACK_TARGET * (1 - attackCoefficient);
+}
+
+void ExponentialADSR::setDecayCoefficient() {
+    double samples = std::max(decayLevel * sampleRate, 1.0);
+    decayCoefficient = (float) std::pow((double) threshold, 1 / samples);
+    decayOffset = sustainLevel * (1 - decayCoefficient);
+}
+
+void ExponentialADSR::setReleaseCoefficient() {
+    double samples = std::max(releaseLevel * sampleRate, 1.0);
+    releaseCoefficient = (float) std::pow((double) threshold, 1 / samples);
+}
+
+
+
+void ExponentialADSR::setAttack(Vst::ParamValue* _value) {
+    attackLevel = *_value;
+    setAttackCoefficient();
+}
+
+void ExponentialADSR::setDecay(Vst::ParamValue* _value) {
+    decayLevel = *_value;
+    setDecayCoefficient();
+}
+
+void ExponentialADSR::setSustain(Vst::ParamValue* _value) {
+    sustainLevel = *_value;
+    setDecayCoefficient();
+}
+
+void ExponentialADSR::setRelease(Vst::ParamValue* _value) {
+    releaseLevel = *_value;
+    setReleaseCoefficient();
+}
+
+void ExponentialADSR::setThreshold(Vst::ParamValue* _value) {
+    threshold = (float) std::min(std::max(*_value, 1e-7), 0.5);
+    setDecayCoefficient();
+    setReleaseCoefficient();
+}
+
+
+
+bool ExponentialADSR::isOn() { return phase != 0; }
+
+float ExponentialADSR::getValue() { return value; }
+
+void ExponentialADSR::press() { phase = 1; }
+void ExponentialADSR::release() { phase = 4; }
+
+float ExponentialADSR::output() {
+    switch (phase) 
+    {
+    case 0:
+        //envelope is off
+        break;
+    case 1:
+        //Attack
+        value = value * attackCoefficient + attackOffset;
+        if (value >= 1) {
+            phase++;
+            value = 1;
+        }
+        break;
+    case 2:
+        //Decay
+        value = value * decayCoefficient + decayOffset;
+        if (value - sustainLevel <= threshold) {
+            phase++;
+            value = sustainLevel;
+        }
+        break;
+    case 3:
+        //Sustain
+        return sustainLevel;
+        break;
+    case 4:
+        //Release
+        value *= releaseCoefficient;
+        if (value <= threshold) {
+            phase = 0;
+            value = 0;
+        }
+        break;
+    }
+    return value;
+}
+
+//the same stages as output(), the block powers of the coefficients replace
+//the multiply-add chain
+int32 ExponentialADSR::renderSegment(float* out, int32 numSamples) {
+    int32 length = numSamples;
+    bool ended = false;
+    switch (phase) 
+    {
+    case 1:
+        //Attack
+        length = curveSegment(out, value, ATTACK_TARGET, 1, 1, attackCoefficient, numSamples, &ended);
+        break;
+    case 2:
+        //Decay
+        length = curveSegment(out, value, sustainLevel, sustainLevel + threshold, sustainLevel,
+                              decayCoefficient, numSamples, &ended);
+        break;
+    case 3:
+        //Sustain
+        std::fill(out, out + numSamples, sustainLevel);
+        break;
+    case 4:
+        //Release
+        length = curveSegment(out, value, 0, threshold, 0, releaseCoefficient, numSamples, &ended);
+        break;
+    default:
+        //envelope is off
+        std::fill(out, out + numSamples, value);
+        break;
+    }
+    if (ended) {
+        phase = phase == 4 ? 0 : phase + 1;
+    }
+    return length;
+}
+
+void ExponentialADSR::process(float* out, int32 numSamples) {
+    int32 i = 0;
+    while (i < numSamples) {
+        i += renderSegment(out + i, numSamples - i);
+    }
+}
+
 
 
 //-----------------------------------------------------------------------------
@@ -310,6 +886,10 @@ Mixer::Mixer() {
     gain = 1;
 }
 
+void Mixer::setBlockSize(int32 maxSamples) {
+    inputBuffer.resize(maxSamples);
+}
+
 float Mixer::output() {
     float output = 0;
 
@@ -321,6 +901,37 @@ float Mixer::output() {
     return output;
 }
 
+int32 Mixer::getNumInputs() { return numInputs; }
+
+CVModule* Mixer::getInput(int32 index) { return inputs[index]; }
+
+void Mixer::processInputs(float* out, const float* const* inputs, int32 numSamples) {
+    std::fill(out, out + numSamples, 0.f);
+
+    for (int i = 0; i < numInputs; i++) {
+        for (int32 j = 0; j < numSamples; j++) {
+            out[j] += inputs[i][j];
+        }
+    }
+    for (int32 j = 0; j < numSamples; j++) {
+        out[j] *= gain;
+    }
+}
+
+void Mixer::process(float* out, int32 numSamples) {
+    std::fill(out, out + numSamples, 0.f);
+
+    for (int i = 0; i < numInputs; i++) {
+        inputs[i]->process(inputBuffer.data(), numSamples);
+        for (int32 j = 0; j < numSamples; j++) {
+            out[j] += inputBuffer[j];
+        }
+    }
+    for (int32 j = 0; j < numSamples; j++) {
+        out[j] *= gain;
+    }
+}
+
 void Mixer::addInput(CVModule* input) {
     inputs.push_back(input);
     numInputs ++;
@@ -339,15 +950,30 @@ FMOsc::FMOsc() {
     modulator = (CVModule*) &NULL_MODULE;
 }
 
-float FMOsc::output() {
-    phase = std::fmod(phase + increment, period);
-    return sin(phase + modulator->output());
+void FMOsc::setBlockSize(int32 maxSamples) {
+    Oscillator::setBlockSize(maxSamples);
+    modBuffer.resize(maxSamples);
+}
+
+float FMOsc::output() { return outputFM(modulator->output()); }
+
+void FMOsc::process(float* out, int32 numSamples) {
+    modulator->process(modBuffer.data(), numSamples);
+    processFM(out, modBuffer.data(), numSamples);
 }
 
 void FMOsc::setModulator(CVModule* mod) {
     modulator = mod;
 }
 
+int32 FMOsc::getNumInputs() { return 1; }
+
+CVModule* FMOsc::getInput(int32 index) { return modulator; }
+
+void FMOsc::processInputs(float* out, const float* const* inputs, int32 numSamples) {
+    processFM(out, inputs[0], numSamples);
+}
+
 
 
 //-----------------------------------------------------------------------------
@@ -365,14 +991,40 @@ void FMOperator::setSampleRate(Vst::SampleRate* _sampleRate) {
     envelope.setSampleRate(_sampleRate);
 }
 
+void FMOperator::setBlockSize(int32 maxSamples) {
+    mixBuffer.resize(maxSamples);
+    osc.setBlockSize(maxSamples);
+    mixer.setBlockSize(maxSamples);
+    amp.setBlockSize(maxSamples);
+    envelope.setBlockSize(maxSamples);
+}
+
 void FMOperator::setFrequency(Vst::ParamValue* freq) { osc.setFrequency(freq); }
 
+void FMOperator::rampFrequency(Vst::ParamValue* freq, int32 numSamples) {
+    osc.rampFrequency(freq, numSamples);
+}
+
+void FMOperator::setFrequencySmoothing(SmoothingMode mode, float seconds) {
+    osc.setFrequencySmoothing(mode, seconds);
+}
+
 void FMOperator::setKeyMod(float mod) { osc.setKeyMod(mod); }
 
+void FMOperator::setSineQuality(SineQuality quality) { osc.setSineQuality(quality); }
+
 void FMOperator::addModulator(CVModule* mod) { mixer.addInput(mod); }
 
 void FMOperator::setVolume(Vst::ParamValue* volume) { amp.setVolume(volume); }
 
+void FMOperator::rampVolume(Vst::ParamValue* volume, int32 numSamples) {
+    amp.rampVolume(volume, numSamples);
+}
+
+void FMOperator::setVolumeSmoothing(SmoothingMode mode, float seconds) {
+    amp.setVolumeSmoothing(mode, seconds);
+}
+
 void FMOperator::setAttack(Vst::ParamValue* _value) { envelope.setAttack(_value); }
 
 void FMOperator::setDecay(Vst::ParamValue* _value) { envelope.setDecay(_value); }
@@ -386,7 +1038,26 @@ LinearADSR* FMOperator::getEnvelopeAddress() { return &envelope; }
 
 float FMOperator::output() { return amp.output(); }
 
+void FMOperator::process(float* out, int32 numSamples) { amp.process(out, numSamples); }
+
 void FMOperator::clear() { mixer.clear(); }
 
+int32 FMOperator::getNumInputs() { return mixer.getNumInputs(); }
+
+CVModule* FMOperator::getInput(int32 index) { return mixer.getInput(index); }
+
+bool FMOperator::pullsInputs() { return amp.isOn(); }
+
+//the oscillator renders into `out`, the amplifier applies the envelope in place
+void FMOperator::processInputs(float* out, const float* const* inputs, int32 numSamples) {
+    if (!inputs) {
+        amp.silence(out, numSamples);
+        return;
+    }
+    mixer.processInputs(mixBuffer.data(), inputs, numSamples);
+    osc.processFrom(out, mixBuffer.data(), numSamples);
+    amp.processFrom(out, out, numSamples);
+}
+
 } //namespace Synth
 } //namespace Steinberg
\ No newline at end of file
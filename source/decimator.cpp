@@ -0,0 +1,182 @@
+#include "../include/decimator.h"
+#include "../include/simdlanes.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Steinberg {
+namespace Synth {
+
+namespace {
+
+//the Kaiser window parameter, about 74 dB of stopband attenuation
+const double KAISER_BETA = 7.5;
+
+//the taps of the stages, the last one works at the output rate
+const int32 STAGE_PAIRS[] = { 12, 6, 5 };
+
+double besselI0(double x) {
+    double sum = 1, term = 1;
+    for (int32 k = 1; k < 32; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+//simd::WIDTH outputs at a time, out[m] for m from 0, returns the first
+//output left to the scalar loop; the double stages have no vector loop
+int32 processLanes(const float* center, const float* inner, const float* outer,
+                   const float* coefs, int32 numPairs, float* out, int32 numOutput) {
+    int32 m = 0;
+    for (; m + simd::WIDTH <= numOutput; m += simd::WIDTH) {
+        simd::Float acc = simd::mul(simd::set(0.5f), simd::load(center + m));
+        for (int32 k = 0; k < numPairs; k++) {
+            simd::Float pair = simd::add(simd::load(inner + m + k), simd::load(outer + m - k));
+            acc = simd::mulAdd(simd::set(coefs[k]), pair, acc);
+        }
+        simd::store(out + m, acc);
+    }
+    return m;
+}
+
+int32 processLanes(const double*, const double*, const double*, const double*, int32, double*, int32) {
+    return 0;
+}
+
+} //namespace
+
+
+
+//-----------------------------------------------------------------------------
+template <typename Sample>
+HalfBandDecimator<Sample>::HalfBandDecimator() {
+    numPairs = 0;
+}
+
+//h(n) = sin(pi n / 2) / (pi n) for the odd n around the centre, scaled so
+//that the gain at DC is exactly 1
+template <typename Sample>
+void HalfBandDecimator<Sample>::setup(int32 _numPairs, int32 maxOutput) {
+    numPairs = _numPairs;
+    coefs.resize(numPairs);
+    const double halfLength = 2 * numPairs;
+    double sum = 0;
+    for (int32 k = 0; k < numPairs; k++) {
+        double n = 2 * k + 1;
+        double sinc = std::sin(M_PI * n / 2) / (M_PI * n);
+        double r = n / halfLength;
+        double window = besselI0(KAISER_BETA * std::sqrt(1 - r * r)) / besselI0(KAISER_BETA);
+        coefs[k] = (Sample) (sinc * window);
+        sum += sinc * window;
+    }
+    for (int32 k = 0; k < numPairs; k++) {
+        coefs[k] = (Sample) (coefs[k] * 0.25 / sum);
+    }
+
+    even.resize(2 * numPairs - 1 + maxOutput);
+    odd.resize(numPairs + maxOutput);
+    reset();
+}
+
+template <typename Sample>
+void HalfBandDecimator<Sample>::reset() {
+    std::fill(even.begin(), even.end(), (Sample) 0);
+    std::fill(odd.begin(), odd.end(), (Sample) 0);
+}
+
+//with E and O the even and odd input samples and m the output sample,
+//out[m] = O[m - P] / 2 + sum of coefs[k] * (E[m - P + 1 + k] + E[m - P - k])
+template <typename Sample>
+void HalfBandDecimator<Sample>::process(const Sample* in, Sample* out, int32 numOutput) {
+    const int32 evenHistory = 2 * numPairs - 1;
+    const int32 oddHistory = numPairs;
+    Sample* e = even.data() + evenHistory;
+    Sample* o = odd.data() + oddHistory;
+    for (int32 i = 0; i < numOutput; i++) {
+        e[i] = in[2 * i];
+        o[i] = in[2 * i + 1];
+    }
+
+    const Sample* center = odd.data();
+    const Sample* inner = even.data() + numPairs;
+    const Sample* outer = even.data() + numPairs - 1;
+    int32 m = processLanes(center, inner, outer, coefs.data(), numPairs, out, numOutput);
+    for (; m < numOutput; m++) {
+        Sample acc = (Sample) 0.5 * center[m];
+        for (int32 k = 0; k < numPairs; k++) {
+            acc += coefs[k] * (inner[m + k] + outer[m - k]);
+        }
+        out[m] = acc;
+    }
+
+    //the end of the block is the history of the next one
+    std::copy(even.begin() + numOutput, even.begin() + numOutput + evenHistory, even.begin());
+    std::copy(odd.begin() + numOutput, odd.begin() + numOutput + oddHistory, odd.begin());
+}
+
+template class HalfBandDecimator<float>;
+template class HalfBandDecimator<double>;
+
+
+
+//-----------------------------------------------------------------------------
+template <typename Sample>
+Decimator<Sample>::Decimator() {
+    numStages = 0;
+    maxSamples = 0;
+}
+
+template <typename Sample>
+void Decimator<Sample>::setup(int32 factor, int32 _maxSamples) {
+    maxSamples = _maxSamples;
+    numStages = 0;
+    while ((1 << numStages) < factor && numStages < MAX_STAGES) {
+        numStages++;
+    }
+    //stage s halves the rate from 2^(numStages - s) to 2^(numStages - s - 1) times the output rate
+    for (int32 s = 0; s < numStages; s++) {
+        int32 numOutput = maxSamples << (numStages - s - 1);
+        stages[s].setup(STAGE_PAIRS[numStages - s - 1], numOutput);
+    }
+    buffer.assign(numStages > 1 ? (size_t) maxSamples << (numStages - 1) : 0, (Sample) 0);
+}
+
+template <typename Sample>
+void Decimator<Sample>::reset() {
+    for (int32 s = 0; s < numStages; s++) {
+        stages[s].reset();
+    }
+}
+
+//the stages before the last one work in place in the buffer, a stage
+//reads all of its input before it writes the first output
+template <typename Sample>
+void Decimator<Sample>::process(const Sample* in, Sample* out, int32 numSamples) {
+    if (numStages == 0) {
+        std::copy(in, in + numSamples, out);
+        return;
+    }
+    const Sample* stageIn = in;
+    for (int32 s = 0; s < numStages; s++) {
+        int32 numOutput = numSamples << (numStages - s - 1);
+        Sample* stageOut = s == numStages - 1 ? out : buffer.data();
+        stages[s].process(stageIn, stageOut, numOutput);
+        stageIn = stageOut;
+    }
+}
+
+template <typename Sample>
+float Decimator<Sample>::getLatency() {
+    float latency = 0;
+    for (int32 s = 0; s < numStages; s++) {
+        latency += (float) stages[s].getLatency() / (1 << (numStages - s));
+    }
+    return latency;
+}
+
+template class Decimator<float>;
+template class Decimator<double>;
+
+} //namespace Synth
+} //namespace Steinberg
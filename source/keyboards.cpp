@@ -1,5 +1,12 @@
 #include "../include/keyboards.h"
 
+#include <algorithm>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 namespace Steinberg {
 namespace Synth {
 
@@ -46,66 +53,322 @@ void DumbMonoKeyboard::clear() {
 }
 
 //-----------------------------------------------------------------------------
+namespace {
+
+//the ratios of the MIDI keys, computed like before the table
+struct KeyRatios
+{
+    float ratio[HeldKeys::NUM_KEYS];
+
+    KeyRatios() {
+        for (int32 key = 0; key < HeldKeys::NUM_KEYS; key++) {
+            ratio[key] = pow(SEMI_TONE_MULTIPLIER, key - 69);
+        }
+    }
+};
+
+const KeyRatios keyRatios;
+
+} //namespace
+
 float pitchToCV(int16* pitch)
 {
+    if (*pitch >= 0 && *pitch < HeldKeys::NUM_KEYS) {
+        return keyRatios.ratio[*pitch];
+    }
     return pow(SEMI_TONE_MULTIPLIER, *pitch - 69);
 }
 
+//2^x = 2^n * 2^f with n the nearest integer and f in [-0.5, 0.5], 2^f is the
+//Taylor series of degree 6, the error is below 5e-7. 2^n is built in the
+//exponent bits, x is clamped to the range of normal floats
+float semitonesToRatio(float semitones)
+{
+    float x = std::max(-126.f, std::min(semitones * (1.f / 12), 126.f));
+    float whole = std::nearbyint(x);
+    float f = x - whole;
+
+    float p = 1.5403530e-4f;
+    p = p * f + 1.3333558e-3f;
+    p = p * f + 9.6181291e-3f;
+    p = p * f + 5.5504109e-2f;
+    p = p * f + 2.4022651e-1f;
+    p = p * f + 6.9314718e-1f;
+    p = p * f + 1.f;
+
+    int32 bits = ((int32) whole + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+//-----------------------------------------------------------------------------
+namespace {
+
+//the index of the highest and of the lowest set bit, x is not 0
+inline int32 highestBit(uint64 x) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, x);
+    return (int32) index;
+#else
+    return 63 - __builtin_clzll(x);
+#endif
+}
+
+inline int32 lowestBit(uint64 x) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return (int32) index;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+inline bool isKey(int16 key) { return key >= 0 && key < HeldKeys::NUM_KEYS; }
+
+} //namespace
+
+HeldKeys::HeldKeys() { clear(); }
+
+void HeldKeys::clear() {
+    bits[0] = bits[1] = 0;
+    first = last = -1;
+    count = 0;
+}
+
+bool HeldKeys::isHeld(int16 key) {
+    return isKey(key) && (bits[key >> 6] >> (key & 63) & 1) != 0;
+}
+
+void HeldKeys::unlink(int16 key) {
+    if (previous[key] >= 0) {
+        next[previous[key]] = next[key];
+    }
+    else {
+        first = next[key];
+    }
+    if (next[key] >= 0) {
+        previous[next[key]] = previous[key];
+    }
+    else {
+        last = previous[key];
+    }
+}
+
+void HeldKeys::press(int16 key) {
+    if (!isKey(key)) {
+        return;
+    }
+    if (isHeld(key)) {
+        unlink(key);
+    }
+    else {
+        bits[key >> 6] |= (uint64) 1 << (key & 63);
+        count++;
+    }
+    previous[key] = last;
+    next[key] = -1;
+    if (last >= 0) {
+        next[last] = key;
+    }
+    else {
+        first = key;
+    }
+    last = key;
+}
+
+void HeldKeys::release(int16 key) {
+    if (!isHeld(key)) {
+        return;
+    }
+    unlink(key);
+    bits[key >> 6] &= ~((uint64) 1 << (key & 63));
+    count--;
+}
+
+int16 HeldKeys::getHighest() {
+    if (bits[1]) {
+        return (int16) (64 + highestBit(bits[1]));
+    }
+    return bits[0] ? (int16) highestBit(bits[0]) : -1;
+}
+
+int16 HeldKeys::getLowest() {
+    if (bits[0]) {
+        return (int16) lowestBit(bits[0]);
+    }
+    return bits[1] ? (int16) (64 + lowestBit(bits[1])) : -1;
+}
+
 //-----------------------------------------------------------------------------
-HighestDumbMonoKeyboard::HighestDumbMonoKeyboard() {
+PriorityMonoKeyboard::PriorityMonoKeyboard(NotePriority _priority, bool _retrigger) {
+    priority = _priority;
+    retrigger = _retrigger;
     currentPitch = -1;
 }
 
-void HighestDumbMonoKeyboard::keyOn(int16* pitch) {
-    if (*pitch > currentPitch) {
-        currentPitch = *pitch;
-        setPitch(pitch);
+int16 PriorityMonoKeyboard::chooseKey() {
+    switch (priority)
+    {
+    case kPriorityHighest:
+        return keys.getHighest();
+    case kPriorityLowest:
+        return keys.getLowest();
+    default:
+        return keys.getLast();
+    }
+}
+
+//the pitch moves to the chosen key, the gate stays open
+void PriorityMonoKeyboard::follow() {
+    int16 key = chooseKey();
+    if (key != currentPitch) {
+        currentPitch = key;
+        setPitch(&currentPitch);
+    }
+}
+
+void PriorityMonoKeyboard::keyOn(int16* pitch) {
+    if (!isKey(*pitch)) {
+        return;
+    }
+    bool first = keys.isEmpty();
+    int16 previousPitch = currentPitch;
+    keys.press(*pitch);
+    follow();
+    if (first || (retrigger && currentPitch != previousPitch)) {
         triggerOn();
     }
 }
 
-void HighestDumbMonoKeyboard::keyOff(int16* pitch) {
-    if (*pitch == currentPitch) {
+void PriorityMonoKeyboard::keyOff(int16* pitch) {
+    if (!keys.isHeld(*pitch)) {
+        return;
+    }
+    keys.release(*pitch);
+    if (keys.isEmpty()) {
+        //the last key was just released, the pitch stays for the release
         currentPitch = -1;
         triggerOff();
     }
+    else {
+        follow();
+    }
+}
+
+void PriorityMonoKeyboard::setPriority(NotePriority _priority) {
+    priority = _priority;
+    if (!keys.isEmpty()) {
+        follow();
+    }
 }
 
 //-----------------------------------------------------------------------------
-void LastMonoKeyboard::keyOn(int16* pitch) {
-    if (pressedKeys.size() == 0) {
-        //the first eky was just pressed
-        triggerOn();
+PolyKeyboard::PolyKeyboard() {
+    for (int32 i = 0; i < MAX_POLYPHONY; i++) {
+        voicePitch[i] = -1;
+        voiceHeld[i] = false;
+        voiceStamp[i] = 0;
+    }
+    std::fill(keyVoice, keyVoice + HeldKeys::NUM_KEYS, -1);
+    polyphony = 16;
+    stealMode = kStealOldest;
+    stampCounter = 0;
+}
+
+int32 PolyKeyboard::findVoice() {
+    //a free voice if there is one
+    for (int32 i = 0; i < polyphony; i++) {
+        if (!isVoiceOn(i)) {
+            return i;
+        }
+    }
+
+    //otherwise steal one, released voices are preferred to held ones
+    int32 best = 0;
+    for (int32 i = 1; i < polyphony; i++) {
+        if (voiceHeld[i] != voiceHeld[best]) {
+            if (!voiceHeld[i]) {
+                best = i;
+            }
+            continue;
+        }
+        if (stealMode == kStealQuietest) {
+            if (getVoiceLevel(i) < getVoiceLevel(best)) {
+                best = i;
+            }
+        }
+        else if (voiceStamp[i] < voiceStamp[best]) {
+            best = i;
+        }
     }
-    
-    for (int i = 0; i < pressedKeys.size(); i++) {
-        if (pressedKeys[i] == *pitch) {
-            //key alredy pressed
-            return;
+    return best;
+}
+
+//a key already pressed retriggers its voice, a held voice that is stolen
+//is not found by its old key any more
+void PolyKeyboard::keyOn(int16* pitch) {
+    if (!isKey(*pitch)) {
+        return;
+    }
+    int32 voice = keyVoice[*pitch];
+    if (voice < 0) {
+        voice = findVoice();
+        if (voiceHeld[voice]) {
+            keyVoice[voicePitch[voice]] = -1;
         }
     }
 
-    pressedKeys.push_back(*pitch);
+    voicePitch[voice] = *pitch;
+    voiceHeld[voice] = true;
+    voiceStamp[voice] = ++stampCounter;
+    keyVoice[*pitch] = (int16) voice;
 
-    setPitch(pitch);
+    startVoice(voice, pitch);
+}
+
+void PolyKeyboard::keyOff(int16* pitch) {
+    if (isKey(*pitch) && keyVoice[*pitch] >= 0) {
+        releaseHeld(keyVoice[*pitch]);
+    }
+}
+
+void PolyKeyboard::releaseHeld(int32 voice) {
+    voiceHeld[voice] = false;
+    keyVoice[voicePitch[voice]] = -1;
+    releaseVoice(voice);
 }
 
-void LastMonoKeyboard::keyOff(int16* pitch) {
-    for (int i = 0; i < pressedKeys.size(); i++) {
-        if (pressedKeys[i] == *pitch) {
-            //remove the key from the list of pressed keys
-            pressedKeys.erase(pressedKeys.begin() + i);
+void PolyKeyboard::allNotesOff() {
+    for (int32 i = 0; i < MAX_POLYPHONY; i++) {
+        if (voiceHeld[i]) {
+            releaseHeld(i);
         }
     }
-    if (pressedKeys.size() == 0) {
-        //the last key was just released
-        triggerOff();
+}
+
+//voices above the polyphony limit are still rendered until they fade out
+bool PolyKeyboard::isOn() {
+    for (int32 i = 0; i < MAX_POLYPHONY; i++) {
+        if (isVoiceOn(i)) {
+            return true;
+        }
     }
-    else {
-        //the second last key is now the last key
-        setPitch(&pressedKeys.back());
+    return false;
+}
+
+void PolyKeyboard::setPolyphony(int32 _polyphony) {
+    polyphony = std::max(1, std::min(_polyphony, MAX_POLYPHONY));
+    for (int32 i = polyphony; i < MAX_POLYPHONY; i++) {
+        if (voiceHeld[i]) {
+            releaseHeld(i);
+        }
     }
 }
 
+void PolyKeyboard::setStealMode(StealMode mode) { stealMode = mode; }
+
 } //namespace Synth
 } //namespace Steinberg
\ No newline at end of file
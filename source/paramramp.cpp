@@ -0,0 +1,202 @@
+#include "../include/paramramp.h"
+#include "../include/simdlanes.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Steinberg {
+namespace Synth {
+
+namespace {
+
+//the one-pole filter snaps to the target when it is this close, relative to
+//the size of the target
+const float SETTLE_THRESHOLD = 1e-4f;
+
+} //namespace
+
+//-----------------------------------------------------------------------------
+ParamRamp::ParamRamp() {
+    value = 0;
+    target = 0;
+    start = 0;
+    length = 0;
+    position = 0;
+    decaying = false;
+    mode = kSmoothNone;
+    smoothingTime = 0;
+    sampleRate = 44100;
+    setCoefficient();
+}
+
+void ParamRamp::setSampleRate(Vst::SampleRate* _sampleRate) {
+    sampleRate = *_sampleRate;
+    setCoefficient();
+}
+
+void ParamRamp::setBlockSize(int32 maxSamples) {
+    buffer.resize(maxSamples);
+}
+
+void ParamRamp::setSmoothing(SmoothingMode _mode, float seconds) {
+    mode = _mode;
+    smoothingTime = seconds;
+    setCoefficient();
+}
+
+void ParamRamp::setCoefficient() {
+    float samples = smoothingTime * sampleRate;
+    coefficient = samples > 1 ? std::exp(-1 / samples) : 0;
+}
+
+void ParamRamp::settle() {
+    value = target;
+    length = 0;
+    position = 0;
+    decaying = false;
+}
+
+
+
+//-----------------------------------------------------------------------------
+void ParamRamp::setValue(float _value) {
+    target = _value;
+    settle();
+}
+
+void ParamRamp::setTarget(float _target) {
+    switch (mode)
+    {
+    case kSmoothLinear:
+        startRamp(_target, (int32) (smoothingTime * sampleRate));
+        break;
+    case kSmoothOnePole:
+        target = _target;
+        length = 0;
+        position = 0;
+        decaying = coefficient > 0 && value != target;
+        if (!decaying) {
+            settle();
+        }
+        break;
+    default:
+        setValue(_target);
+        break;
+    }
+}
+
+void ParamRamp::rampTo(float _target, int32 numSamples) {
+    if (numSamples <= 0) {
+        setTarget(_target);
+        return;
+    }
+    startRamp(_target, numSamples);
+}
+
+void ParamRamp::startRamp(float _target, int32 numSamples) {
+    if (numSamples <= 0) {
+        setValue(_target);
+        return;
+    }
+    start = value;
+    target = _target;
+    length = numSamples;
+    position = 0;
+    decaying = false;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// The linear ramp computes every value from the start of the ramp, so the
+// error does not accumulate and the last value is exactly the target.
+// The one-pole filter is computed in closed form, target + d * c^n, so that
+// the lanes do not depend on each other.
+//-----------------------------------------------------------------------------
+float ParamRamp::next() {
+    if (position < length) {
+        position++;
+        value = position == length ? target : start + (target - start) * position / length;
+    }
+    else if (decaying) {
+        value = target + (value - target) * coefficient;
+        if (std::fabs(value - target) <= SETTLE_THRESHOLD * std::max(std::fabs(target), 1.f)) {
+            settle();
+        }
+    }
+    return value;
+}
+
+const float* ParamRamp::render(int32 numSamples) {
+    float* out = buffer.data();
+    if (numSamples <= 0) {
+        return out;
+    }
+
+    if (decaying) {
+        const float distance = value - target;
+        float power = 1;
+        float lanes[simd::WIDTH];
+        for (int32 lane = 0; lane < simd::WIDTH; lane++) {
+            power *= coefficient;
+            lanes[lane] = power;
+        }
+        simd::Float powers = simd::load(lanes);
+        const simd::Float step = simd::set(power);      //coefficient ^ WIDTH
+
+        int32 i = 0;
+        for (; i + simd::WIDTH <= numSamples; i += simd::WIDTH) {
+            simd::store(out + i, simd::mulAdd(simd::set(distance), powers, simd::set(target)));
+            powers = simd::mul(powers, step);
+        }
+        simd::store(lanes, powers);
+        for (int32 lane = 0; i < numSamples; i++, lane++) {
+            out[i] = target + distance * lanes[lane];
+        }
+
+        value = out[numSamples - 1];
+        if (std::fabs(value - target) <= SETTLE_THRESHOLD * std::max(std::fabs(target), 1.f)) {
+            settle();
+        }
+        return out;
+    }
+
+    int32 ramping = std::min(numSamples, length - position);
+    if (ramping > 0) {
+        const float slope = (target - start) / length;
+        simd::Float index = simd::add(simd::ramp(), simd::set((float) (position + 1)));
+
+        int32 i = 0;
+        for (; i + simd::WIDTH <= ramping; i += simd::WIDTH) {
+            simd::store(out + i, simd::mulAdd(simd::set(slope), index, simd::set(start)));
+            index = simd::add(index, simd::set((float) simd::WIDTH));
+        }
+        for (; i < ramping; i++) {
+            out[i] = start + slope * (position + i + 1);
+        }
+
+        position += ramping;
+        value = position == length ? target : out[ramping - 1];
+        out[ramping - 1] = value;
+    }
+    std::fill(out + std::max(ramping, 0), out + numSamples, value);
+    return out;
+}
+
+void ParamRamp::skip(int32 numSamples) {
+    if (decaying) {
+        value = target + (value - target) * std::pow(coefficient, (float) numSamples);
+        if (std::fabs(value - target) <= SETTLE_THRESHOLD * std::max(std::fabs(target), 1.f)) {
+            settle();
+        }
+        return;
+    }
+    int32 ramping = std::min(numSamples, length - position);
+    if (ramping > 0) {
+        position += ramping;
+        value = position == length ? target : start + (target - start) * position / length;
+    }
+}
+
+} //namespace Synth
+} //namespace Steinberg
@@ -0,0 +1,181 @@
+#include "../include/patchgraph.h"
+
+#include <algorithm>
+
+namespace Steinberg {
+namespace Synth {
+
+//-----------------------------------------------------------------------------
+PatchGraph::PatchGraph() {
+    output = nullptr;
+    compiled = false;
+    maxSamples = 0;
+    numBuffers = 0;
+}
+
+void PatchGraph::clear() {
+    output = nullptr;
+    compiled = false;
+    steps.clear();
+    inputSteps.clear();
+    inputBlocks.clear();
+    buffers.clear();
+    numBuffers = 0;
+    needed.clear();
+    pulls.clear();
+}
+
+bool PatchGraph::compile(CVModule* _output, int32 _maxSamples) {
+    clear();
+    output = _output;
+    maxSamples = _maxSamples;
+    if (!output || maxSamples <= 0) {
+        return false;
+    }
+
+    std::vector<CVModule*> path;
+    if (addStep(output, path) < 0) {
+        //feedback, process() pulls the output module
+        steps.clear();
+        inputSteps.clear();
+        return false;
+    }
+
+    assignBuffers();
+    needed.resize(steps.size());
+    pulls.resize(steps.size());
+    compiled = true;
+    return true;
+}
+
+//the inputs are added before the module, so the steps are sorted;
+//a module feeding several modules has one step, it is rendered once per
+//block and all of them read its buffer
+int32 PatchGraph::addStep(CVModule* module, std::vector<CVModule*>& path) {
+    if (!module || std::find(path.begin(), path.end(), module) != path.end()) {
+        return -1;
+    }
+
+    path.push_back(module);
+    if (module->forwardsInput()) {
+        int32 step = addStep(module->getInput(0), path);
+        path.pop_back();
+        return step;
+    }
+
+    for (size_t s = 0; s < steps.size(); s++) {
+        if (steps[s].module == module) {
+            path.pop_back();
+            return (int32) s;
+        }
+    }
+
+    int32 numInputs = module->getNumInputs();
+    std::vector<int32> inputs(numInputs);
+    for (int32 i = 0; i < numInputs; i++) {
+        inputs[i] = addStep(module->getInput(i), path);
+        if (inputs[i] < 0) {
+            path.pop_back();
+            return -1;
+        }
+    }
+    path.pop_back();
+
+    Step step = { module, (int32) inputSteps.size(), numInputs, -1 };
+    inputSteps.insert(inputSteps.end(), inputs.begin(), inputs.end());
+    steps.push_back(step);
+    return (int32) steps.size() - 1;
+}
+
+//a buffer is taken by a step and given back after the last step reading it,
+//a step never renders into a buffer it reads
+void PatchGraph::assignBuffers() {
+    const int32 numSteps = (int32) steps.size();
+    std::vector<int32> lastRead(numSteps);
+    for (int32 s = 0; s < numSteps; s++) {
+        lastRead[s] = s;
+        for (int32 k = 0; k < steps[s].numInputs; k++) {
+            int32 input = inputSteps[steps[s].firstInput + k];
+            lastRead[input] = std::max(lastRead[input], s);
+        }
+    }
+
+    std::vector<int32> freeBuffers;
+    std::vector<char> released(numSteps, 0);
+    numBuffers = 0;
+    for (int32 s = 0; s < numSteps; s++) {
+        if (s == numSteps - 1) {
+            steps[s].buffer = -1;
+        }
+        else if (!freeBuffers.empty()) {
+            steps[s].buffer = freeBuffers.back();
+            freeBuffers.pop_back();
+        }
+        else {
+            steps[s].buffer = numBuffers++;
+        }
+
+        for (int32 k = 0; k < steps[s].numInputs; k++) {
+            int32 input = inputSteps[steps[s].firstInput + k];
+            if (lastRead[input] == s && !released[input]) {
+                freeBuffers.push_back(steps[input].buffer);
+                released[input] = 1;
+            }
+        }
+    }
+
+    //the buffers are fixed from now on, so are the blocks the steps read
+    buffers.assign((size_t) numBuffers * maxSamples, 0.f);
+    inputBlocks.resize(inputSteps.size());
+    for (size_t i = 0; i < inputSteps.size(); i++) {
+        inputBlocks[i] = buffers.data() + (size_t) steps[inputSteps[i]].buffer * maxSamples;
+    }
+}
+
+void PatchGraph::process(float* out, int32 numSamples) {
+    if (!compiled) {
+        if (output) {
+            output->process(out, numSamples);
+        }
+        else {
+            std::fill(out, out + numSamples, 0.f);
+        }
+        return;
+    }
+    for (int32 start = 0; start < numSamples; start += maxSamples) {
+        processBlock(out + start, std::min(maxSamples, numSamples - start));
+    }
+}
+
+//the modules decide whether they read their inputs before anything is
+//rendered, starting from the output, the steps nobody reads are skipped
+void PatchGraph::processBlock(float* out, int32 numSamples) {
+    const int32 last = (int32) steps.size() - 1;
+    std::fill(needed.begin(), needed.end(), 0);
+    needed[last] = 1;
+    for (int32 s = last; s >= 0; s--) {
+        if (!needed[s]) {
+            continue;
+        }
+        pulls[s] = steps[s].module->pullsInputs();
+        if (pulls[s]) {
+            for (int32 k = 0; k < steps[s].numInputs; k++) {
+                needed[inputSteps[steps[s].firstInput + k]] = 1;
+            }
+        }
+    }
+
+    for (int32 s = 0; s <= last; s++) {
+        if (!needed[s]) {
+            steps[s].module->skip(numSamples);
+            continue;
+        }
+        const Step& step = steps[s];
+        float* block = step.buffer < 0 ? out : buffers.data() + (size_t) step.buffer * maxSamples;
+        const float* const* inputs = pulls[s] ? inputBlocks.data() + step.firstInput : nullptr;
+        step.module->processInputs(block, inputs, numSamples);
+    }
+}
+
+} //namespace Synth
+} //namespace Steinberg
@@ -36,9 +36,16 @@
 
 #include "../include/plugcontroller.h"
 #include "../include/plugids.h"
+#include "../include/fmalgorithms.h"
+#include "../include/keyboards.h"
+#include "../include/presetstate.h"
+#include "../include/sinekernels.h"
+#include "../include/workerpool.h"
 
-#include "base/source/fstreamer.h"
 #include "pluginterfaces/base/ibstream.h"
+#include "pluginterfaces/base/ustring.h"
+
+#include <cstdio>
 
 namespace Steinberg {
 namespace Synth {
@@ -50,52 +57,134 @@ tresult PLUGIN_API PlugController::initialize (FUnknown* context)
 	if (result == kResultTrue)
 	{
 		//---Create Parameters------------
-		parameters.addParameter (STR16 ("Operator 1 level"), STR16 ("?"), 0, .5,
-		                         Vst::ParameterInfo::kCanAutomate, SynthParams::kParamOp1_levelId, 0,
-		                         STR16 ("Op1 level"));
-		parameters.addParameter (STR16 ("Operator 1 frequency"), STR16 ("?"), 0, .5,
-		                         Vst::ParameterInfo::kCanAutomate, SynthParams::kParamOp1_frequencyId, 0,
-		                         STR16 ("Op1 frequency"));
-		parameters.addParameter (STR16 ("Operator 1 attack"), STR16 ("seconds"), 0, .5,
-		                         Vst::ParameterInfo::kCanAutomate, SynthParams::kParamOp1_attackId, 0,
-		                         STR16 ("Op1 attack"));
-		parameters.addParameter (STR16 ("Operator 1 decay"), STR16 ("seconds"), 0, .5,
-		                         Vst::ParameterInfo::kCanAutomate, SynthParams::kParamOp1_decayId, 0,
-		                         STR16 ("Op1 decay"));
-		parameters.addParameter (STR16 ("Operator 1 sustain"), STR16 ("seconds"), 0, .5,
-		                         Vst::ParameterInfo::kCanAutomate, SynthParams::kParamOp1_sustainId, 0,
-		                         STR16 ("Op1 sustain"));
-		parameters.addParameter (STR16 ("Operator 1 release"), STR16 ("seconds"), 0, .5,
-		                         Vst::ParameterInfo::kCanAutomate, SynthParams::kParamOp1_releaseId, 0,
-		                         STR16 ("Op1 release"));
-
-		parameters.addParameter (STR16 ("Operator 2 level"), STR16 ("?"), 0, .5,
-		                         Vst::ParameterInfo::kCanAutomate, SynthParams::kParamOp2_levelId, 0,
-		                         STR16 ("Op2 level"));
-		parameters.addParameter (STR16 ("Operator 2 frequency"), STR16 ("?"), 0, .5,
-		                         Vst::ParameterInfo::kCanAutomate, SynthParams::kParamOp2_frequencyId, 0,
-		                         STR16 ("Op2 frequency"));
-		parameters.addParameter (STR16 ("Operator 2 attack"), STR16 ("seconds"), 0, .5,
-		                         Vst::ParameterInfo::kCanAutomate, SynthParams::kParamOp2_attackId, 0,
-		                         STR16 ("Op2 attack"));
-		parameters.addParameter (STR16 ("Operator 2 decay"), STR16 ("seconds"), 0, .5,
-		                         Vst::ParameterInfo::kCanAutomate, SynthParams::kParamOp2_decayId, 0,
-		                         STR16 ("Op2 decay"));
-		parameters.addParameter (STR16 ("Operator 2 sustain"), STR16 ("seconds"), 0, .5,
-		                         Vst::ParameterInfo::kCanAutomate, SynthParams::kParamOp2_sustainId, 0,
-		                         STR16 ("Op2 sustain"));
-		parameters.addParameter (STR16 ("Operator 2 release"), STR16 ("seconds"), 0, .5,
-		                         Vst::ParameterInfo::kCanAutomate, SynthParams::kParamOp2_releaseId, 0,
-		                         STR16 ("Op2 release"));
-
-		parameters.addParameter (STR16 ("Master Volume"), STR16 ("?"), 0, .5,
+		// the defaults are those the processor starts with
+		PresetState defaults;
+		defaults.setDefaults ();
+
+		// the parameters of every operator, the first two came before the
+		// feedback and the other operators, see findOperatorParam
+		static const struct
+		{
+			const char* name;
+			const char* units;
+		} OPERATOR_PARAMS[kNumOperatorParams] = {
+			{ "level", "?" },
+			{ "frequency", "?" },
+			{ "attack", "seconds" },
+			{ "decay", "seconds" },
+			{ "sustain", "" },
+			{ "release", "seconds" },
+			{ "feedback", "?" },
+		};
+		for (int32 op = 0; op < MAX_FM_OPERATORS; op++)
+		{
+			for (int32 i = 0; i < NUM_PARAMS; i++)
+			{
+				Vst::ParamID id = FIRST_PARAM_ID + i;
+				int32 idOp, param;
+				if (!findOperatorParam (id, idOp, param) || idOp != op)
+					continue;
+
+				char text[64];
+				UString128 title, shortTitle, units;
+				std::snprintf (text, sizeof (text), "Operator %d %s", op + 1, OPERATOR_PARAMS[param].name);
+				title.fromAscii (text);
+				std::snprintf (text, sizeof (text), "Op%d %s", op + 1, OPERATOR_PARAMS[param].name);
+				shortTitle.fromAscii (text);
+				units.fromAscii (OPERATOR_PARAMS[param].units);
+				parameters.addParameter (title, units, 0, defaults[id],
+				                         Vst::ParameterInfo::kCanAutomate, id, 0, shortTitle);
+			}
+		}
+
+		// list parameter, one step per entry of FM_ALGORITHMS, the first
+		// one is the 2 operator patch
+		parameters.addParameter (STR16 ("Algorithm"), nullptr, kNumFMAlgorithms - 1,
+		                         defaults[SynthParams::kParamAlgorithmId],
+		                         Vst::ParameterInfo::kCanAutomate | Vst::ParameterInfo::kIsList,
+		                         SynthParams::kParamAlgorithmId, 0, STR16 ("Algorithm"));
+
+		parameters.addParameter (STR16 ("Master Volume"), STR16 ("?"), 0,
+		                         defaults[SynthParams::kParamMasterVolumeId],
 		                         Vst::ParameterInfo::kCanAutomate, SynthParams::kParamMasterVolumeId, 0,
 		                         STR16 ("Volume"));
 
+		// list parameter, one step per SineQuality
+		parameters.addParameter (STR16 ("Oscillator quality"), nullptr, kNumSineQualities - 1,
+		                         defaults[SynthParams::kParamSineQualityId],
+		                         Vst::ParameterInfo::kCanAutomate | Vst::ParameterInfo::kIsList,
+		                         SynthParams::kParamSineQualityId, 0, STR16 ("Quality"));
+
+		// one step per number of voices, from 1 to MAX_POLYPHONY, 16 by default
+		parameters.addParameter (STR16 ("Polyphony"), STR16 ("voices"), PolyKeyboard::MAX_POLYPHONY - 1,
+		                         defaults[SynthParams::kParamPolyphonyId],
+		                         Vst::ParameterInfo::kCanAutomate, SynthParams::kParamPolyphonyId, 0,
+		                         STR16 ("Voices"));
+		// list parameter, one step per StealMode
+		parameters.addParameter (STR16 ("Voice stealing"), nullptr, kNumStealModes - 1,
+		                         defaults[SynthParams::kParamVoiceStealingId],
+		                         Vst::ParameterInfo::kCanAutomate | Vst::ParameterInfo::kIsList,
+		                         SynthParams::kParamVoiceStealingId, 0, STR16 ("Stealing"));
+
+		// one step per number of threads rendering the voices, from 1 to
+		// WorkerPool::MAX_THREADS, read by the processor when it is activated,
+		// see PlugProcessor::requestRestart. Experimental, the speedup on more
+		// than one core is not measured yet
+		parameters.addParameter (STR16 ("Render threads"), STR16 ("threads"), WorkerPool::MAX_THREADS - 1,
+		                         defaults[SynthParams::kParamRenderThreadsId],
+		                         0, SynthParams::kParamRenderThreadsId, 0,
+		                         STR16 ("Threads"));
+		// list parameter: 1x, 2x, 4x, 8x, the rate of the oscillators, read by
+		// the processor when it is activated, see PlugProcessor::requestRestart
+		parameters.addParameter (STR16 ("Oversampling"), nullptr, 3, defaults[SynthParams::kParamOversamplingId],
+		                         Vst::ParameterInfo::kIsList, SynthParams::kParamOversamplingId, 0,
+		                         STR16 ("Oversampling"));
+		// set by the processor, see setParamNormalized
+		parameters.addParameter (STR16 ("Restart"), nullptr, 1, 0,
+		                         Vst::ParameterInfo::kIsReadOnly | Vst::ParameterInfo::kIsHidden,
+		                         SynthParams::kParamRestartId, 0, STR16 ("Restart"));
+
+		// the pitch bend wheel, see getMidiControllerAssignment, centered
+		parameters.addParameter (STR16 ("Pitch bend"), nullptr, 0, defaults[SynthParams::kParamPitchBendId],
+		                         Vst::ParameterInfo::kCanAutomate, SynthParams::kParamPitchBendId, 0,
+		                         STR16 ("Bend"));
+		// one step per semitone, from 0 to MAX_PITCH_BEND_RANGE, 2 by default
+		parameters.addParameter (STR16 ("Pitch bend range"), STR16 ("semitones"), MAX_PITCH_BEND_RANGE,
+		                         defaults[SynthParams::kParamPitchBendRangeId],
+		                         Vst::ParameterInfo::kCanAutomate, SynthParams::kParamPitchBendRangeId, 0,
+		                         STR16 ("Bend range"));
 	}
 	return kResultTrue;
 }
 
+//-----------------------------------------------------------------------------
+tresult PLUGIN_API PlugController::getMidiControllerAssignment (int32 busIndex, int16 channel,
+                                                                Vst::CtrlNumber midiControllerNumber,
+                                                                Vst::ParamID& id)
+{
+	// the host sends the pitch bend of every channel as this parameter
+	if (busIndex == 0 && midiControllerNumber == Vst::kPitchBend)
+	{
+		id = SynthParams::kParamPitchBendId;
+		return kResultTrue;
+	}
+	return kResultFalse;
+}
+
+//-----------------------------------------------------------------------------
+tresult PLUGIN_API PlugController::setParamNormalized (Vst::ParamID tag, Vst::ParamValue value)
+{
+	// the processor sets kParamRestartId once it has a setup it cannot apply
+	// while active, it is cleared so the next request changes it again
+	if (tag == SynthParams::kParamRestartId)
+	{
+		if (value > 0 && componentHandler)
+			componentHandler->restartComponent (Vst::kLatencyChanged);
+		return EditController::setParamNormalized (tag, 0);
+	}
+	return EditController::setParamNormalized (tag, value);
+}
+
 //------------------------------------------------------------------------
 tresult PLUGIN_API PlugController::setComponentState (IBStream* state)
 {
@@ -104,65 +193,15 @@ tresult PLUGIN_API PlugController::setComponentState (IBStream* state)
 	if (!state)
 		return kResultFalse;
 
-	IBStreamer streamer (state, kLittleEndian);
-
-	//operator 1
-	float op1_level = 0.f;
-	if (streamer.readFloat (op1_level) == false)
-		return kResultFalse;
-	setParamNormalized (SynthParams::kParamOp1_levelId, op1_level);
-	float op1_frequency = 0.f;
-	if (streamer.readFloat (op1_frequency) == false)
-		return kResultFalse;
-	setParamNormalized (SynthParams::kParamOp1_frequencyId, op1_frequency);
-	float op1_attack = 0.f;
-	if (streamer.readFloat (op1_attack) == false)
-		return kResultFalse;
-	setParamNormalized (SynthParams::kParamOp1_attackId, op1_attack);
-	float op1_decay = 0.f;
-	if (streamer.readFloat (op1_decay) == false)
-		return kResultFalse;
-	setParamNormalized (SynthParams::kParamOp1_decayId, op1_decay);
-	float op1_sustain = 0.f;
-	if (streamer.readFloat (op1_sustain) == false)
-		return kResultFalse;
-	setParamNormalized (SynthParams::kParamOp1_sustainId, op1_sustain);
-	float op1_release = 0.f;
-	if (streamer.readFloat (op1_release) == false)
-		return kResultFalse;
-	setParamNormalized (SynthParams::kParamOp1_releaseId, op1_release);
-
-	//operator 2
-	float op2_level = 0.f;
-	if (streamer.readFloat (op1_level) == false)
+	// the format of PlugProcessor::getState, the values are normalized
+	PresetState preset;
+	if (!preset.read (state))
 		return kResultFalse;
-	setParamNormalized (SynthParams::kParamOp2_levelId, op2_level);
-	float op2_frequency = 0.f;
-	if (streamer.readFloat (op1_frequency) == false)
-		return kResultFalse;
-	setParamNormalized (SynthParams::kParamOp2_frequencyId, op2_frequency);
-	float op2_attack = 0.f;
-	if (streamer.readFloat (op1_attack) == false)
-		return kResultFalse;
-	setParamNormalized (SynthParams::kParamOp2_attackId, op2_attack);
-	float op2_decay = 0.f;
-	if (streamer.readFloat (op1_decay) == false)
-		return kResultFalse;
-	setParamNormalized (SynthParams::kParamOp2_decayId, op2_decay);
-	float op2_sustain = 0.f;
-	if (streamer.readFloat (op1_sustain) == false)
-		return kResultFalse;
-	setParamNormalized (SynthParams::kParamOp2_sustainId, op2_sustain);
-	float op2_release = 0.f;
-	if (streamer.readFloat (op1_release) == false)
-		return kResultFalse;
-	setParamNormalized (SynthParams::kParamOp2_releaseId, op2_release);
-
-	//volume
-	float masterVolume = 0.f;
-	if (streamer.readFloat (masterVolume) == false)
-		return kResultFalse;
-	setParamNormalized (SynthParams::kParamMasterVolumeId, masterVolume);
+	for (int32 i = 0; i < NUM_PARAMS; i++)
+	{
+		if (PresetState::isSaved (FIRST_PARAM_ID + i))
+			setParamNormalized (FIRST_PARAM_ID + i, preset.values[i]);
+	}
 
 	return kResultOk;
 }
@@ -36,14 +36,16 @@
 
 #include "../include/plugprocessor.h"
 #include "../include/plugids.h"
+#include "../include/realtime.h"
 
-#include "base/source/fstreamer.h"
 #include "pluginterfaces/base/ibstream.h"
 #include "pluginterfaces/vst/ivstparameterchanges.h"
 
 #include "pluginterfaces/vst/ivstevents.h"
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 namespace Steinberg {
 namespace Synth {
@@ -51,6 +53,21 @@ namespace Synth {
 //-----------------------------------------------------------------------------
 PlugProcessor::PlugProcessor ()
 {
+	blockSize = 0;
+	numParamCursors = 0;
+	renderThreads = 1;
+	startedThreads = 1;
+	oversampling = 1;
+	restartRequested = false;
+	pitchBend = .5;
+	pitchBendRange = 2;
+
+	// the modules start with the defaults, nothing has to be applied
+	PresetState defaults;
+	defaults.setDefaults ();
+	for (int32 i = 0; i < NUM_PARAMS; i++)
+		paramValues[i].store (defaults.values[i], std::memory_order_relaxed);
+
 	// register its editor class
 	setControllerClass (MyControllerUID);
 }
@@ -85,18 +102,32 @@ tresult PLUGIN_API PlugProcessor::setBusArrangements (Vst::SpeakerArrangement* i
 	return kResultFalse;
 }
 
+//-----------------------------------------------------------------------------
+tresult PLUGIN_API PlugProcessor::canProcessSampleSize (int32 symbolicSampleSize)
+{
+	// the voices render in float for both, the 64-bit buses are summed,
+	// decimated and amplified in double, see renderAudio
+	if (symbolicSampleSize == Vst::kSample32 || symbolicSampleSize == Vst::kSample64)
+		return kResultTrue;
+	return kResultFalse;
+}
+
 //-----------------------------------------------------------------------------
 tresult PLUGIN_API PlugProcessor::setupProcessing (Vst::ProcessSetup& setup)
 {
 	// here you get, with setup, information about:
 	// sampleRate, processMode, maximum number of samples per audio block
 	sampleRate = setup.sampleRate;
-	op1.setSampleRate(&sampleRate);
-	op2.setSampleRate(&sampleRate);
-	//gate.setSampleRate(&sampleRate);
-	mixer.setSampleRate(&sampleRate);
+	keyboard.setSampleRate(&sampleRate);
 	amp.setSampleRate(&sampleRate);
 
+	// the modules render in blocks, their buffers are allocated here
+	blockSize = setup.maxSamplesPerBlock;
+	keyboard.setDoublePrecision (setup.symbolicSampleSize == Vst::kSample64);
+	keyboard.setBlockSize(blockSize);
+	amp.setBlockSize(blockSize);
+	renderBuffer.resize(blockSize);
+
 	return AudioEffect::setupProcessing (setup);
 }
 
@@ -108,29 +139,33 @@ tresult PLUGIN_API PlugProcessor::setActive (TBool state)
 		// Allocate Memory Here
 		// Ex: algo.create ();
 
-		keyboard.addPitchReceiver(&op1);
-		keyboard.addPitchReceiver(&op2);
-		//keyboard.addGateReceiver(&gate);
-		keyboard.addGateReceiver(op1.getEnvelopeAddress());
-		keyboard.addGateReceiver(op2.getEnvelopeAddress());
-
-		//mixer.addInput(&op1);
-		mixer.addInput(&op2);
-
-		amp.setInput(&mixer);
-		//amp.setModulator(&gate);
-
-		
-		op2.addModulator(&op1);
+		// process is not running, a preset loaded before the activation sets
+		// the threads and the oversampling used below
+		applyPendingState ();
+
+		// the voices are wired by the keyboard, see FM_ALGORITHMS
+		amp.setInput(&keyboard);
+		patch.compile(&amp, blockSize);
+
+		// allocates, like the threads below a change of kParamOversamplingId
+		// takes effect at the next activation, the latency changes with it,
+		// see requestRestart
+		keyboard.setOversampling (oversampling);
+		restartRequested = false;
+
+		// the threads are created here and not in process, a change of
+		// kParamRenderThreadsId takes effect at the next activation
+		pool.start (renderThreads - 1, PolyKeyboard::MAX_POLYPHONY / simd::WIDTH);
+		startedThreads = renderThreads;
+		keyboard.setWorkerPool (pool.getNumWorkers () > 0 ? &pool : nullptr);
 	}
 	else // Release
 	{
-		op1.clear();
-		op2.clear();
-		mixer.clear();
-		//gate.clear();
+		keyboard.allNotesOff();
 		amp.clear();
-		keyboard.clear();
+		patch.clear();
+		keyboard.setWorkerPool (nullptr);
+		pool.stop ();
 		
 		// Free Memory if still allocated
 		// Ex: if(algo.isCreated ()) { algo.destroy (); }
@@ -138,9 +173,214 @@ tresult PLUGIN_API PlugProcessor::setActive (TBool state)
 	return AudioEffect::setActive (state);
 }
 
+//-----------------------------------------------------------------------------
+uint32 PLUGIN_API PlugProcessor::getLatencySamples ()
+{
+	// the decimator of the oversampled voices, the host compensates it
+	return (uint32) (keyboard.getLatency () + 0.5f);
+}
+
+//-----------------------------------------------------------------------------
+namespace {
+
+// the levels, the frequencies, the master volume and the pitch bend follow
+// the automation as ramps, the other parameters change at the points
+bool isRamped (Vst::ParamID id)
+{
+	int32 op, param;
+	if (findOperatorParam (id, op, param))
+		return param == kOpLevel || param == kOpFrequency;
+	return id == SynthParams::kParamMasterVolumeId || id == SynthParams::kParamPitchBendId;
+}
+
+// a block without a note on cannot wake an idle synth up
+bool startsNote (Vst::IEventList* inputEvents)
+{
+	if (!inputEvents)
+		return false;
+	for (int32 i = 0; i < inputEvents->getEventCount (); i++)
+	{
+		Vst::Event event;
+		if (inputEvents->getEvent (i, event) == kResultTrue &&
+		    event.type == Vst::Event::kNoteOnEvent)
+			return true;
+	}
+	return false;
+}
+
+Vst::Sample32** getChannelBuffers (Vst::AudioBusBuffers& bus, Vst::Sample32*)
+{
+	return bus.channelBuffers32;
+}
+
+Vst::Sample64** getChannelBuffers (Vst::AudioBusBuffers& bus, Vst::Sample64*)
+{
+	return bus.channelBuffers64;
+}
+
+// tells the host which channels it can skip
+void setSilence (Vst::AudioBusBuffers& bus, bool silent)
+{
+	bus.silenceFlags = 0;
+	if (silent)
+	{
+		for (int32 j = 0; j < bus.numChannels; j++)
+			bus.silenceFlags |= (uint64) 1 << j;
+	}
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+void PlugProcessor::applyParameter(Vst::ParamID id, Vst::ParamValue value, int32 rampSamples)
+{
+	if (PresetState::isParam (id))
+		paramValues[id - FIRST_PARAM_ID].store (value, std::memory_order_relaxed);
+
+	switch (id)
+	{
+		case SynthParams::kParamMasterVolumeId:
+			amp.rampVolume(&value, rampSamples);
+			break;
+
+		case SynthParams::kParamPolyphonyId:
+			keyboard.setPolyphony(1 + std::min (
+			    (int32) (value * PolyKeyboard::MAX_POLYPHONY),
+			    PolyKeyboard::MAX_POLYPHONY - 1));
+			break;
+		case SynthParams::kParamVoiceStealingId:
+			keyboard.setStealMode((StealMode) std::min (
+			    (int32) (value * kNumStealModes), kNumStealModes - 1));
+			break;
+
+		case SynthParams::kParamRenderThreadsId:
+			renderThreads = 1 + std::min (
+			    (int32) (value * WorkerPool::MAX_THREADS), WorkerPool::MAX_THREADS - 1);
+			break;
+
+		case SynthParams::kParamOversamplingId:
+			oversampling = 1 << std::min ((int32) (value * 4), 3);
+			break;
+
+		case SynthParams::kParamPitchBendId:
+			pitchBend = value;
+			applyPitchBend(rampSamples);
+			break;
+		case SynthParams::kParamPitchBendRangeId:
+			pitchBendRange = std::min ((int32) (value * (MAX_PITCH_BEND_RANGE + 1)),
+			                           MAX_PITCH_BEND_RANGE);
+			applyPitchBend(0);
+			break;
+
+		case SynthParams::kParamSineQualityId:
+		{
+			SineQuality quality = (SineQuality) std::min (
+			    (int32) (value * kNumSineQualities), kNumSineQualities - 1);
+			keyboard.setSineQuality(quality);
+			break;
+		}
+
+		case SynthParams::kParamAlgorithmId:
+			keyboard.setAlgorithm(std::min ((int32) (value * kNumFMAlgorithms), kNumFMAlgorithms - 1));
+			break;
+
+		default:
+		{
+			int32 op, param;
+			if (findOperatorParam (id, op, param))
+				applyOperatorParameter(op, param, value, rampSamples);
+			break;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+void PlugProcessor::applyOperatorParameter(int32 op, int32 param, Vst::ParamValue value,
+                                           int32 rampSamples)
+{
+	switch (param)
+	{
+		case kOpLevel:
+			value *= (2 * M_PI);
+			keyboard.rampOperatorVolume(op, &value, rampSamples);
+			break;
+		case kOpFrequency:
+			value *= 880;
+			keyboard.rampOperatorFrequency(op, &value, rampSamples);
+			break;
+		case kOpAttack:
+			value += 0.005;
+			keyboard.setOperatorAttack(op, &value);
+			break;
+		case kOpDecay:
+			keyboard.setOperatorDecay(op, &value);
+			break;
+		case kOpSustain:
+			keyboard.setOperatorSustain(op, &value);
+			break;
+		case kOpRelease:
+			value += 0.005;
+			keyboard.setOperatorRelease(op, &value);
+			break;
+		case kOpFeedback:
+			// up to pi, beyond it the operator turns into noise
+			value *= M_PI;
+			keyboard.setOperatorFeedback(op, &value);
+			break;
+	}
+}
+
+//-----------------------------------------------------------------------------
+void PlugProcessor::applyPitchBend(int32 rampSamples)
+{
+	// one ratio per automation point, the keyboard ramps between them and
+	// multiplies it with the keys, a moving bend does not call pow or divide
+	Vst::ParamValue ratio = semitonesToRatio ((float) ((2 * pitchBend - 1) * pitchBendRange));
+	keyboard.rampPitchBend(&ratio, rampSamples);
+}
+
+//-----------------------------------------------------------------------------
+void PlugProcessor::applyPendingState()
+{
+	// the latest preset given to setState, like automation points at the
+	// start of the block: the levels and the frequencies are smoothed
+	if (!pendingState.consume ())
+		return;
+	const PresetState& state = pendingState.readBuffer ();
+	for (int32 i = 0; i < NUM_PARAMS; i++)
+	{
+		Vst::ParamID id = FIRST_PARAM_ID + i;
+		if (PresetState::isSaved (id))
+			applyParameter (id, state.values[i], 0);
+	}
+}
+
+//-----------------------------------------------------------------------------
+void PlugProcessor::requestRestart(Vst::IParameterChanges* outputParameterChanges)
+{
+	// the factor and the threads asked for are applied by setActive. The
+	// controller asks the host for a restart when kParamRestartId is set; the
+	// host reactivates the processor and reads the latency, there is no flag
+	// for a restart alone
+	if (oversampling == keyboard.getOversampling () && renderThreads == startedThreads)
+	{
+		restartRequested = false;
+		return;
+	}
+	if (restartRequested || !outputParameterChanges)
+		return;
+
+	int32 index;
+	Vst::IParamValueQueue* queue = outputParameterChanges->addParameterData (SynthParams::kParamRestartId, index);
+	if (queue && queue->addPoint (0, 1, index) == kResultTrue)
+		restartRequested = true;
+}
+
 //-----------------------------------------------------------------------------
 void PlugProcessor::readParameterChanges(Vst::IParameterChanges* inputParameterChanges)
 {
+	// the points are applied while the block is rendered, see processParameterChanges
+	numParamCursors = 0;
 	if (inputParameterChanges)
 	{
 		int32 numParamsChanged = inputParameterChanges->getParameterCount ();
@@ -148,94 +388,89 @@ void PlugProcessor::readParameterChanges(Vst::IParameterChanges* inputParameterC
 		{
 			Vst::IParamValueQueue* paramQueue =
 			    inputParameterChanges->getParameterData (index);
-			if (paramQueue)
+			if (!paramQueue)
+				continue;
+
+			if (numParamCursors == MAX_PARAM_QUEUES)
 			{
+				// more parameters than the plug-in has, only the last point is applied
 				Vst::ParamValue value;
 				int32 sampleOffset;
-				int32 numPoints = paramQueue->getPointCount ();
-				switch (paramQueue->getParameterId ())
-				{
-					case SynthParams::kParamOp1_levelId:
-						if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) ==
-						    kResultTrue)
-							value *= (2 * M_PI);
-							op1.setVolume(&value);
-						break;
-					case SynthParams::kParamOp1_frequencyId:
-						if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) ==
-						    kResultTrue);
-							value *= 880;
-							op1.setFrequency(&value);
-						break;
-					case SynthParams::kParamOp1_attackId:
-						if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) ==
-						    kResultTrue)
-							value += 0.005;
-							op1.setAttack(&value);
-						break;
-					case SynthParams::kParamOp1_decayId:
-						if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) ==
-						    kResultTrue)
-							op1.setDecay(&value);
-						break;
-					case SynthParams::kParamOp1_sustainId:
-						if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) ==
-						    kResultTrue)
-							op1.setSustain(&value);
-						break;
-					case SynthParams::kParamOp1_releaseId:
-						if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) ==
-						    kResultTrue)
-							value += 0.005;
-							op1.setRelease(&value);
-						break;
-
-					case SynthParams::kParamOp2_levelId:
-						if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) ==
-						    kResultTrue)
-							value *= (2 * M_PI);
-							op2.setVolume(&value);
-						break;
-					case SynthParams::kParamOp2_frequencyId:
-						if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) ==
-						    kResultTrue);
-							value *= 880;
-							op2.setFrequency(&value);
-						break;
-					case SynthParams::kParamOp2_attackId:
-						if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) ==
-						    kResultTrue)
-							value += 0.005;
-							op2.setAttack(&value);
-						break;
-					case SynthParams::kParamOp2_decayId:
-						if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) ==
-						    kResultTrue)
-							op2.setDecay(&value);
-						break;
-					case SynthParams::kParamOp2_sustainId:
-						if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) ==
-						    kResultTrue)
-							op2.setSustain(&value);
-						break;
-					case SynthParams::kParamOp2_releaseId:
-						if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) ==
-						    kResultTrue)
-							value += 0.005;
-							op2.setRelease(&value);
-						break;
-
-					case SynthParams::kParamMasterVolumeId:
-						if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) ==
-						    kResultTrue)
-							amp.setVolume(&value);
-						break;
-				}
+				if (paramQueue->getPoint (paramQueue->getPointCount () - 1, sampleOffset, value) ==
+				    kResultTrue)
+					applyParameter (paramQueue->getParameterId (), value, 0);
+				continue;
 			}
+
+			ParamCursor& cursor = paramCursors[numParamCursors++];
+			cursor.queue = paramQueue;
+			cursor.id = paramQueue->getParameterId ();
+			cursor.point = 0;
+			cursor.nextOffset = 0;
+			cursor.ramping = false;
 		}
 	}
 }
 
+//-----------------------------------------------------------------------------
+void PlugProcessor::advanceParameter(ParamCursor& cursor, int32 position, int32 numSamples)
+{
+	int32 numPoints = cursor.queue->getPointCount ();
+	while (cursor.point < numPoints)
+	{
+		Vst::ParamValue value;
+		int32 offset;
+		if (cursor.queue->getPoint (cursor.point, offset, value) != kResultTrue)
+		{
+			cursor.point++;
+			continue;
+		}
+
+		offset = std::min(offset, numSamples);
+		if (offset > position)
+		{
+			// a ramped parameter moves towards the point, the others wait for it
+			if (isRamped (cursor.id) && !cursor.ramping)
+			{
+				applyParameter (cursor.id, value, offset - position);
+				cursor.ramping = true;
+			}
+			cursor.nextOffset = offset;
+			return;
+		}
+
+		// a ramp arrives at the value of the point by itself
+		if (!cursor.ramping)
+			applyParameter (cursor.id, value, 0);
+		cursor.ramping = false;
+		cursor.point++;
+	}
+	cursor.nextOffset = std::numeric_limits<int32>::max ();
+}
+
+//-----------------------------------------------------------------------------
+void PlugProcessor::processParameterChanges(int32 position, int32 numSamples)
+{
+	for (int32 i = 0; i < numParamCursors; i++)
+	{
+		if (paramCursors[i].nextOffset <= position)
+			advanceParameter(paramCursors[i], position, numSamples);
+	}
+}
+
+//-----------------------------------------------------------------------------
+void PlugProcessor::processEvent(Vst::Event& event)
+{
+	if (event.type == Vst::Event::kNoteOnEvent)
+	{
+		keyboard.keyOn(&event.noteOn.pitch);
+	}
+	else if (event.type == Vst::Event::kNoteOffEvent)
+	{
+		keyboard.keyOff(&event.noteOff.pitch);
+	}
+}
+
 //-----------------------------------------------------------------------------
 void PlugProcessor::processEvents(Vst::IEventList* inputEvents)
 {
@@ -246,63 +481,143 @@ void PlugProcessor::processEvents(Vst::IEventList* inputEvents)
 			Vst::Event event;
 			if (inputEvents->getEvent(i, event) == kResultTrue)
 			{
-				if (event.type == Vst::Event::kNoteOnEvent)
-				{
-					keyboard.keyOn(&event.noteOn.pitch);
-				}
-				else if (event.type == Vst::Event::kNoteOffEvent)
-				{
-					keyboard.keyOff(&event.noteOff.pitch);
-				}
+				processEvent(event);
 			}
 		}
 	}
 }
 
 //-----------------------------------------------------------------------------
-void PlugProcessor::processAudio(Vst::AudioBusBuffers* outputs, int32 numSamples)
+void PlugProcessor::renderAudio(Vst::Sample32* out, int32 numSamples)
 {
-	for (int32 i = 0; i < numSamples; i++)
+	// the patch never renders more than the buffers allocated in setActive at once
+	patch.process(out, numSamples);
+}
+
+//-----------------------------------------------------------------------------
+void PlugProcessor::renderAudio(Vst::Sample64* out, int32 numSamples)
+{
+	// the patch is the amplifier on the keyboard, both have a double path:
+	// the voices are summed into double lanes, decimated and amplified in
+	// double. A silent amplifier goes through the patch, which skips the keyboard
+	if (!amp.isOn ())
 	{
-		for (int32 j = 0; j < outputs[0].numChannels; j++)
-		{
-			outputs[0].channelBuffers32[j][i] = 0;
-		}
+		patch.process(renderBuffer.data(), numSamples);
+		std::fill(out, out + numSamples, 0.);
+		return;
 	}
-	
-	for (int32 i = 0; i < numSamples; i++)
+	keyboard.process(out, numSamples);
+	amp.amplify(out, out, numSamples);
+}
+
+//-----------------------------------------------------------------------------
+template <typename SampleType>
+void PlugProcessor::processAudio(Vst::AudioBusBuffers* outputs, int32 numSamples,
+                                 Vst::IEventList* inputEvents)
+{
+	// without a block size the patch is not set up, the host still gets a
+	// silent block and not what was left in its buffers
+	SampleType** channels = getChannelBuffers(outputs[0], (SampleType*) nullptr);
+	if (outputs[0].numChannels == 0 || blockSize <= 0)
 	{
-		float value = amp.output();
-		//float value = 0;
+		processParameterChanges(numSamples, numSamples);
+		processEvents(inputEvents);
 		for (int32 j = 0; j < outputs[0].numChannels; j++)
+			std::fill(channels[j], channels[j] + numSamples, (SampleType) 0);
+		setSilence(outputs[0], true);
+		return;
+	}
+
+	// render the first channel up to each event and each automation point,
+	// so that notes start and end at their sampleOffset and parameters move
+	// between the points and not at the start of the block.
+	// The host sends the events sorted, an event that is out of order or out
+	// of the block is applied at the current position.
+	SampleType* first = channels[0];
+
+	// while every envelope is idle the block is silent, the parameters and the
+	// note offs are applied at once and the patch only zeroes the output
+	if (!keyboard.isOn() && !startsNote(inputEvents))
+	{
+		processParameterChanges(numSamples, numSamples);
+		processEvents(inputEvents);
+		renderAudio(first, numSamples);
+		for (int32 j = 1; j < outputs[0].numChannels; j++)
+			std::fill(channels[j], channels[j] + numSamples, (SampleType) 0);
+		setSilence(outputs[0], true);
+		return;
+	}
+
+	bool silent = true;
+	int32 position = 0;
+	int32 numEvents = inputEvents ? inputEvents->getEventCount() : 0;
+	int32 eventIndex = 0;
+	Vst::Event event;
+	bool hasEvent = false;
+	do
+	{
+		while (!hasEvent && eventIndex < numEvents)
+			hasEvent = inputEvents->getEvent(eventIndex++, event) == kResultTrue;
+
+		int32 eventOffset = numSamples;
+		if (hasEvent)
+			eventOffset = std::min(std::max(event.sampleOffset, position), numSamples);
+
+		int32 next = eventOffset;
+		for (int32 i = 0; i < numParamCursors; i++)
+			next = std::min(next, paramCursors[i].nextOffset);
+
+		silent = silent && !amp.isOn();
+		renderAudio(first + position, next - position);
+		position = next;
+
+		processParameterChanges(position, numSamples);
+		if (hasEvent && eventOffset <= position)
 		{
-			outputs[0].channelBuffers32[j][i] = value;
+			processEvent(event);
+			hasEvent = false;
 		}
+	} while (position < numSamples || hasEvent || eventIndex < numEvents);
+
+	// the synth is mono, the remaining channels are copies of the first one
+	for (int32 j = 1; j < outputs[0].numChannels; j++)
+	{
+		std::copy(first, first + numSamples, channels[j]);
 	}
+	setSilence(outputs[0], silent);
 }
 
 //-----------------------------------------------------------------------------
 tresult PLUGIN_API PlugProcessor::process (Vst::ProcessData& data)
 {
+	// nothing below allocates or frees, a build with SYNTH_ALLOCATION_GUARD
+	// aborts if it does; the release tails are not slowed down by denormals
+	DenormalGuard denormals;
+	AllocationGuard noAllocation;
+
+	// a preset first, the automation of the block overrides it
+	applyPendingState();
+
 	//--- Read inputs parameter changes-----------
 	readParameterChanges(data.inputParameterChanges);
 
-	processEvents(data.inputEvents);
 	//--- Process Audio---------------------
 	//--- ----------------------------------
-	if (data.numOutputs == 0)
+	if (data.numOutputs == 0 || data.numSamples <= 0)
 	{
-		// nothing to do
+		// nothing to render, the parameters and the notes still have to be set
+		processParameterChanges(std::max(data.numSamples, 0), std::max(data.numSamples, 0));
+		processEvents(data.inputEvents);
+		requestRestart(data.outputParameterChanges);
 		return kResultOk;
 	}
 
-	if (data.numSamples > 0)
-	{
-		// Process Algorithm
-		// Ex: algo.process (data.inputs[0].channelBuffers32, data.outputs[0].channelBuffers32,
-		// data.numSamples);
-		processAudio(data.outputs, data.numSamples);
-	}
+	// the events and the automation are applied while rendering, at their sampleOffset
+	if (data.symbolicSampleSize == Vst::kSample64)
+		processAudio<Vst::Sample64>(data.outputs, data.numSamples, data.inputEvents);
+	else
+		processAudio<Vst::Sample32>(data.outputs, data.numSamples, data.inputEvents);
+	requestRestart(data.outputParameterChanges);
 	return kResultOk;
 }
 
@@ -312,128 +627,36 @@ tresult PLUGIN_API PlugProcessor::setState (IBStream* state)
 	if (!state)
 		return kResultFalse;
 
-	// called when we load a preset or project, the model has to be reloaded
-
-	IBStreamer streamer (state, kLittleEndian);
-
-	//operator 1
-	float op1_level = 0.f;
-	if (streamer.readFloat (op1_level) == false)
-		return kResultFalse;
-	float op1_frequency = 0.f;
-	if (streamer.readFloat (op1_frequency) == false)
-		return kResultFalse;
-	float op1_attack = 0.f;
-	if (streamer.readFloat (op1_attack) == false)
-		return kResultFalse;
-	float op1_decay = 0.f;
-	if (streamer.readFloat (op1_decay) == false)
-		return kResultFalse;
-	float op1_sustain = 0.f;
-	if (streamer.readFloat (op1_sustain) == false)
-		return kResultFalse;
-	float op1_release = 0.f;
-	if (streamer.readFloat (op1_release) == false)
-		return kResultFalse;
-
-	//operator 2	
-	float op2_level = 0.f;
-	if (streamer.readFloat (op1_level) == false)
-		return kResultFalse;
-	float op2_frequency = 0.f;
-	if (streamer.readFloat (op1_frequency) == false)
-		return kResultFalse;
-	float op2_attack = 0.f;
-	if (streamer.readFloat (op1_attack) == false)
-		return kResultFalse;
-	float op2_decay = 0.f;
-	if (streamer.readFloat (op1_decay) == false)
-		return kResultFalse;
-	float op2_sustain = 0.f;
-	if (streamer.readFloat (op1_sustain) == false)
-		return kResultFalse;
-	float op2_release = 0.f;
-	if (streamer.readFloat (op1_release) == false)
-		return kResultFalse;
-	
-	//volume
-	float masterVolume = 0.f;
-	if (streamer.readFloat (masterVolume) == false)
+	// called when we load a preset or project, from another thread than
+	// process: nothing is applied here, the audio thread takes the values
+	// at the start of its next block, without waiting and without locks.
+	// Only one thread calls setState at a time.
+	PresetState& preset = pendingState.writeBuffer ();
+	if (!preset.read (state))
 		return kResultFalse;
 
-	
-	//operator 1
-	op1.setVolume((Vst::ParamValue*) &op1_level);
-	op1.setFrequency((Vst::ParamValue*) &op1_frequency);
-	op1.setAttack((Vst::ParamValue*) &op1_attack);
-	op1.setDecay((Vst::ParamValue*) &op1_decay);
-	op1.setSustain((Vst::ParamValue*) &op1_sustain);
-	op1.setRelease((Vst::ParamValue*) &op1_release);
-	
-	//operator 2
-	op2.setVolume((Vst::ParamValue*) &op2_level);
-	op2.setFrequency((Vst::ParamValue*) &op2_frequency);
-	op2.setAttack((Vst::ParamValue*) &op2_attack);
-	op2.setDecay((Vst::ParamValue*) &op2_decay);
-	op2.setSustain((Vst::ParamValue*) &op2_sustain);
-	op2.setRelease((Vst::ParamValue*) &op2_release);
-
-	//volume
-	amp.setVolume((Vst::ParamValue*) &masterVolume);
-
+	// a getState that comes before the next block saves the loaded preset
+	for (int32 i = 0; i < NUM_PARAMS; i++)
+	{
+		if (PresetState::isSaved (FIRST_PARAM_ID + i))
+			paramValues[i].store (preset.values[i], std::memory_order_relaxed);
+	}
+	pendingState.publish ();
 	return kResultOk;
 }
 
 //------------------------------------------------------------------------
 tresult PLUGIN_API PlugProcessor::getState (IBStream* state)
 {
-	// here we need to save the model (preset or project)
-
-	//float toSaveParam1 = mParam1;
-
-	IBStreamer streamer (state, kLittleEndian);
-	//streamer.writeFloat (toSaveParam1);
-
-	//operator 1
-	float op1_level = 1;
-	float op1_frequency = 440;
-	float op1_attack = 0.005;
-	float op1_decay = 0;
-	float op1_sustain = 1;
-	float op1_release = 0.005;
-
-	//operator 2	
-	float op2_level = 1;
-	float op2_frequency = 440;
-	float op2_attack = 0.005;
-	float op2_decay = 0;
-	float op2_sustain = 1;
-	float op2_release = 0.005;
-	
-	//volume
-	float masterVolume = 1;
-
-	
-	//operator 1
-	streamer.writeFloat(op1_level);
-	streamer.writeFloat(op1_frequency);
-	streamer.writeFloat(op1_attack);
-	streamer.writeFloat(op1_decay);
-	streamer.writeFloat(op1_sustain);
-	streamer.writeFloat(op1_release);
-	
-	//operator 2
-	streamer.writeFloat(op2_level);
-	streamer.writeFloat(op2_frequency);
-	streamer.writeFloat(op2_attack);
-	streamer.writeFloat(op2_decay);
-	streamer.writeFloat(op2_sustain);
-	streamer.writeFloat(op2_release);
-
-	//volume
-	streamer.writeFloat(masterVolume);
+	// here we need to save the model (preset or project), the values the
+	// audio thread applied last, each one is read atomically
+	if (!state)
+		return kResultFalse;
 
-	return kResultOk;
+	PresetState preset;
+	for (int32 i = 0; i < NUM_PARAMS; i++)
+		preset.values[i] = paramValues[i].load (std::memory_order_relaxed);
+	return preset.write (state) ? kResultOk : kResultFalse;
 }
 
 //------------------------------------------------------------------------
@@ -0,0 +1,120 @@
+#include "../include/presetstate.h"
+
+#include "../include/keyboards.h"
+#include "../include/sinekernels.h"
+
+#include "base/source/fstreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Steinberg {
+namespace Synth {
+
+namespace {
+
+const int32 STATE_VERSION = 2;
+
+//the first versions wrote 13 floats, the first one was always 1
+bool isFirstVersion(int32 tag) {
+    float first = 1.f;
+    int32 bits;
+    std::memcpy(&bits, &first, sizeof(bits));
+    return tag == bits;
+}
+
+} //namespace
+
+//the first two operators came before the feedback and the other operators,
+//their ids are not in the same block
+bool findOperatorParam(Vst::ParamID id, int32& op, int32& param) {
+    if (id >= SynthParams::kParamOp1_levelId && id <= SynthParams::kParamOp2_releaseId) {
+        op = (id - SynthParams::kParamOp1_levelId) / kOpFeedback;
+        param = (id - SynthParams::kParamOp1_levelId) % kOpFeedback;
+        return true;
+    }
+    if (id == SynthParams::kParamOp1_feedbackId || id == SynthParams::kParamOp2_feedbackId) {
+        op = id - SynthParams::kParamOp1_feedbackId;
+        param = kOpFeedback;
+        return true;
+    }
+    if (id >= SynthParams::kParamOp3_levelId && id <= SynthParams::kParamOp6_feedbackId) {
+        op = 2 + (id - SynthParams::kParamOp3_levelId) / kNumOperatorParams;
+        param = (id - SynthParams::kParamOp3_levelId) % kNumOperatorParams;
+        return true;
+    }
+    return false;
+}
+
+//the normalized values of the defaults of FMVoiceBank, Amplifier and
+//PlugProcessor, applyParameter maps them back to the same settings
+void PresetState::setDefaults() {
+    //level 1 radian, 440 Hz, 5 ms attack and decay, full sustain, 5 ms release, no feedback
+    const Vst::ParamValue operatorDefaults[kNumOperatorParams] = { 1 / (2 * M_PI), .5, 0, .005, 1, 0, 0 };
+    for (int32 i = 0; i < NUM_PARAMS; i++) {
+        int32 op, param;
+        values[i] = findOperatorParam(FIRST_PARAM_ID + i, op, param) ? operatorDefaults[param] : 0;
+    }
+
+    (*this)[SynthParams::kParamMasterVolumeId] = 1;
+    (*this)[SynthParams::kParamSineQualityId] =
+        (Vst::ParamValue) SYNTH_DEFAULT_SINE_QUALITY / (kNumSineQualities - 1);
+    (*this)[SynthParams::kParamPolyphonyId] = 15. / (PolyKeyboard::MAX_POLYPHONY - 1);
+    (*this)[SynthParams::kParamPitchBendId] = .5;
+    (*this)[SynthParams::kParamPitchBendRangeId] = 2. / MAX_PITCH_BEND_RANGE;
+    //stealing, threads, oversampling and algorithm start at their first step
+}
+
+bool PresetState::read(IBStream* stream) {
+    IBStreamer streamer(stream, kLittleEndian);
+    setDefaults();
+
+    int32 version;
+    if (!streamer.readInt32(version)) {
+        return false;
+    }
+    if (isFirstVersion(version)) {
+        return true;
+    }
+    if (version != STATE_VERSION) {
+        return false;
+    }
+
+    int32 count;
+    if (!streamer.readInt32(count)) {
+        return false;
+    }
+    for (int32 i = 0; i < count; i++) {
+        int32 id;
+        Vst::ParamValue value;
+        if (!streamer.readInt32(id) || !streamer.readDouble(value)) {
+            return false;
+        }
+        if (isSaved((Vst::ParamID) id)) {
+            (*this)[(Vst::ParamID) id] = std::max(0., std::min(value, 1.));
+        }
+    }
+    return true;
+}
+
+bool PresetState::write(IBStream* stream) const {
+    IBStreamer streamer(stream, kLittleEndian);
+    int32 count = 0;
+    for (int32 i = 0; i < NUM_PARAMS; i++) {
+        count += isSaved(FIRST_PARAM_ID + i) ? 1 : 0;
+    }
+    if (!streamer.writeInt32(STATE_VERSION) || !streamer.writeInt32(count)) {
+        return false;
+    }
+    for (int32 i = 0; i < NUM_PARAMS; i++) {
+        if (isSaved(FIRST_PARAM_ID + i) &&
+            (!streamer.writeInt32(FIRST_PARAM_ID + i) || !streamer.writeDouble(values[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} //namespace Synth
+} //namespace Steinberg
@@ -0,0 +1,108 @@
+#include "../include/realtime.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <xmmintrin.h>
+#define SYNTH_DENORMALS_SSE
+#elif defined(__aarch64__)
+#define SYNTH_DENORMALS_AARCH64
+#endif
+
+#ifdef SYNTH_ALLOCATION_GUARD
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#endif
+
+namespace Steinberg {
+namespace Synth {
+
+namespace {
+
+#if defined(SYNTH_DENORMALS_SSE)
+const uint32 FLUSH_TO_ZERO = 0x8000;
+const uint32 DENORMALS_ARE_ZERO = 0x0040;
+#elif defined(SYNTH_DENORMALS_AARCH64)
+const uint64 FLUSH_TO_ZERO = (uint64) 1 << 24;
+#endif
+
+#ifdef SYNTH_ALLOCATION_GUARD
+thread_local int32 guardDepth = 0;
+#endif
+
+} //namespace
+
+
+
+//-----------------------------------------------------------------------------
+DenormalGuard::DenormalGuard() {
+#if defined(SYNTH_DENORMALS_SSE)
+    savedMode = _mm_getcsr();
+    _mm_setcsr((uint32) savedMode | FLUSH_TO_ZERO | DENORMALS_ARE_ZERO);
+#elif defined(SYNTH_DENORMALS_AARCH64)
+    uint64 mode;
+    asm volatile("mrs %0, fpcr" : "=r"(mode));
+    savedMode = mode;
+    asm volatile("msr fpcr, %0" : : "r"(mode | FLUSH_TO_ZERO));
+#else
+    savedMode = 0;
+#endif
+}
+
+DenormalGuard::~DenormalGuard() {
+#if defined(SYNTH_DENORMALS_SSE)
+    _mm_setcsr((uint32) savedMode);
+#elif defined(SYNTH_DENORMALS_AARCH64)
+    asm volatile("msr fpcr, %0" : : "r"(savedMode));
+#endif
+}
+
+
+
+#ifdef SYNTH_ALLOCATION_GUARD
+//-----------------------------------------------------------------------------
+AllocationGuard::AllocationGuard() { guardDepth++; }
+
+AllocationGuard::~AllocationGuard() { guardDepth--; }
+
+bool AllocationGuard::isActive() { return guardDepth > 0; }
+#endif
+
+} //namespace Synth
+} //namespace Steinberg
+
+
+
+#ifdef SYNTH_ALLOCATION_GUARD
+//-----------------------------------------------------------------------------
+// The replaceable allocation functions, the other forms of new (arrays,
+// nothrow) call these. fprintf does not allocate for an unbuffered stderr.
+//-----------------------------------------------------------------------------
+void* operator new(std::size_t size) {
+    if (Steinberg::Synth::AllocationGuard::isActive()) {
+        std::fprintf(stderr, "Synth: %zu bytes allocated on the audio thread\n", size);
+        std::abort();
+    }
+    void* p = std::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+
+//free can take the same locks as malloc
+void operator delete(void* p) noexcept {
+    if (p && Steinberg::Synth::AllocationGuard::isActive()) {
+        std::fprintf(stderr, "Synth: memory freed on the audio thread\n");
+        std::abort();
+    }
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept { operator delete(p); }
+
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+
+void operator delete[](void* p, std::size_t) noexcept { operator delete(p); }
+#endif
@@ -0,0 +1,222 @@
+#include "../include/sinekernels.h"
+
+#include "../include/simdlanes.h"
+
+#include <cmath>
+
+namespace Steinberg {
+namespace Synth {
+
+namespace {
+
+using simd::TWO_PI;
+using simd::INV_TWO_PI;
+using simd::INV_PI;
+using simd::PI_HI;
+using simd::PI_LO;
+
+//std::floor is a library call without SSE4.1, a truncation is used instead
+inline float wrapPhase(float phase) {
+    float cycles = phase * INV_TWO_PI;
+    float whole = (float) (int32) cycles;
+    if (whole > cycles) {
+        whole -= 1;
+    }
+    return phase - TWO_PI * whole;
+}
+
+//-----------------------------------------------------------------------------
+// One period of the sine, with a guard point for the interpolation,
+// filled when the library is loaded.
+//-----------------------------------------------------------------------------
+const int32 TABLE_SIZE = 2048;
+float SINE_TABLE[TABLE_SIZE + 1];
+
+struct SineTableInit
+{
+    SineTableInit() {
+        for (int32 i = 0; i <= TABLE_SIZE; i++) {
+            SINE_TABLE[i] = (float) std::sin(i * (6.28318530717958647692 / TABLE_SIZE));
+        }
+    }
+} SINE_TABLE_INIT;
+
+//the top bits of a phase are the index in the table, the others the fraction
+const int32 TABLE_BITS = 11;
+const int32 FRACTION_BITS = 32 - TABLE_BITS;
+const float FRACTION_SCALE = 1.f / (1 << FRACTION_BITS);
+
+static_assert(TABLE_SIZE == 1 << TABLE_BITS, "the table is indexed with the top bits of a Phase");
+
+//no wrapping and no rounding at the end of the table, the phase is in range
+inline float tableSinOfPhase(Phase phase) {
+    int32 index = (int32) (phase >> FRACTION_BITS);
+    float frac = (float) (int32) (phase & ((1 << FRACTION_BITS) - 1)) * FRACTION_SCALE;
+    return SINE_TABLE[index] + frac * (SINE_TABLE[index + 1] - SINE_TABLE[index]);
+}
+
+} //namespace
+
+Phase cyclesToPhase(double cycles) {
+    double fraction = cycles - std::floor(cycles);
+    //a fraction that rounds to a whole period wraps to 0
+    return (Phase) (uint64) (fraction * 4294967296.0 + 0.5);
+}
+
+float tableSin(float x) {
+    float position = wrapPhase(x) * (TABLE_SIZE * INV_TWO_PI);
+    int32 index = (int32) position;
+    if (index >= TABLE_SIZE) {
+        //rounding can push the wrapped phase up to 2pi
+        index = TABLE_SIZE - 1;
+    }
+    float frac = position - index;
+    return SINE_TABLE[index] + frac * (SINE_TABLE[index + 1] - SINE_TABLE[index]);
+}
+
+//the same polynomial as simd::sin, one sample at a time
+float fastSin(float x) {
+    float k = std::nearbyint(x * INV_PI);
+    float r = (x - k * PI_HI) - k * PI_LO;
+    float r2 = r * r;
+    float p = 2.599344725e-6f;
+    p = p * r2 - 1.980622910e-4f;
+    p = p * r2 + 8.333010599e-3f;
+    p = p * r2 - 1.666665673e-1f;
+    p = p * r2 * r + r;
+    return ((long) k & 1) ? -p : p;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Every lane of the vector loop holds the phase of one sample and advances
+// by WIDTH increments, the integer additions are exact, so the lanes do not
+// drift apart from the phase the scalar loops would reach.
+// Without SIMD support simd::WIDTH is 1 and the scalar loops below do the work.
+//-----------------------------------------------------------------------------
+namespace {
+
+template <bool FM>
+int32 renderLanes(float* out, Phase* phase, Phase increment, const float* mod, int32 numSamples) {
+    if (simd::WIDTH == 1) {
+        return 0;
+    }
+
+    Phase first[simd::WIDTH];
+    for (int32 k = 0; k < simd::WIDTH; k++) {
+        first[k] = *phase + (k + 1) * increment;
+    }
+    simd::Int p = simd::loadInt(first);
+    const simd::Int step = simd::setInt(simd::WIDTH * increment);
+
+    int32 i = 0;
+    for (; i + simd::WIDTH <= numSamples; i += simd::WIDTH) {
+        simd::Float x = simd::phaseToRadians(p);
+        if (FM) {
+            x = simd::add(x, simd::load(mod + i));
+        }
+        simd::store(out + i, simd::sin(x));
+        p = simd::add(p, step);
+    }
+    *phase += i * increment;
+    return i;
+}
+
+} //namespace
+
+
+
+//-----------------------------------------------------------------------------
+// The table and the libm tiers are scalar, the table tier has no gather to
+// vectorize with on SSE2 and the libm tier is the reference.
+// Like the vector loops they compute every phase from the start of the block.
+//-----------------------------------------------------------------------------
+namespace {
+
+template <bool FM>
+void renderScalar(float* out, Phase* phase, Phase increment, const float* mod, int32 numSamples,
+                  SineQuality quality) {
+    Phase p = *phase;
+    switch (quality)
+    {
+    case kSineTable:
+        for (int32 i = 0; i < numSamples; i++) {
+            p += increment;
+            out[i] = FM ? tableSin(phaseToRadians(p) + mod[i]) : tableSinOfPhase(p);
+        }
+        break;
+    case kSineExact:
+        for (int32 i = 0; i < numSamples; i++) {
+            p += increment;
+            float x = phaseToRadians(p);
+            out[i] = (float) std::sin((double) (FM ? x + mod[i] : x));
+        }
+        break;
+    default:
+        for (int32 i = 0; i < numSamples; i++) {
+            p += increment;
+            float x = phaseToRadians(p);
+            out[i] = fastSin(FM ? x + mod[i] : x);
+        }
+        break;
+    }
+    *phase = p;
+}
+
+} //namespace
+
+void sineBlock(float* out, Phase* phase, Phase increment, int32 numSamples,
+               SineQuality quality) {
+    int32 i = 0;
+    if (quality == kSinePolynomial) {
+        i = renderLanes<false>(out, phase, increment, nullptr, numSamples);
+    }
+    renderScalar<false>(out + i, phase, increment, nullptr, numSamples - i, quality);
+}
+
+void fmSineBlock(float* out, Phase* phase, Phase increment, const float* mod, int32 numSamples,
+                 SineQuality quality) {
+    int32 i = 0;
+    if (quality == kSinePolynomial) {
+        i = renderLanes<true>(out, phase, increment, mod, numSamples);
+    }
+    renderScalar<true>(out + i, phase, increment, mod + i, numSamples - i, quality);
+}
+
+//the phases are accumulated first, then the sine of all of them is taken
+//by the FM kernel with a zero increment
+void sweepBlock(float* out, Phase* phase, const float* frequency, float scale, const float* mod,
+                int32 numSamples, SineQuality quality) {
+    int32 i = 0;
+    Phase p = *phase;
+    if (simd::WIDTH > 1) {
+        //the increments of WIDTH samples are converted at once, then added one by one
+        Phase increments[simd::WIDTH];
+        for (; i + simd::WIDTH <= numSamples; i += simd::WIDTH) {
+            simd::Float cycles = simd::mul(simd::load(frequency + i), simd::set(scale));
+            simd::storeInt(increments, simd::cyclesToPhase(cycles));
+            for (int32 k = 0; k < simd::WIDTH; k++) {
+                p += increments[k];
+                out[i + k] = phaseToRadians(p);
+            }
+        }
+    }
+    for (; i < numSamples; i++) {
+        float cycles = frequency[i] * scale;
+        p += (Phase) (int64) std::nearbyint((cycles - std::nearbyint(cycles)) * simd::PHASE_PER_CYCLE);
+        out[i] = phaseToRadians(p);
+    }
+    *phase = p;
+
+    if (mod) {
+        for (i = 0; i < numSamples; i++) {
+            out[i] += mod[i];
+        }
+    }
+    Phase zero = 0;
+    fmSineBlock(out, &zero, 0, out, numSamples, quality);
+}
+
+} //namespace Synth
+} //namespace Steinberg
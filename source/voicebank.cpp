@@ -0,0 +1,749 @@
+#include "../include/voicebank.h"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+namespace Steinberg {
+namespace Synth {
+
+namespace {
+
+//the phases of LinearADSR
+const float ENV_OFF = 0;
+const float ENV_ATTACK = 1;
+const float ENV_DECAY = 2;
+const float ENV_SUSTAIN = 3;
+const float ENV_RELEASE = 4;
+
+//-----------------------------------------------------------------------------
+/** One sample of LinearADSR::output() for every lane */
+inline simd::Float envelopeStep(simd::Float& value, simd::Float& stage,
+                                simd::Float attackInc, simd::Float decayInc,
+                                simd::Float sustain, simd::Float releaseInc) {
+    simd::Float attack = simd::equal(stage, simd::set(ENV_ATTACK));
+    simd::Float decay = simd::equal(stage, simd::set(ENV_DECAY));
+    simd::Float release = simd::equal(stage, simd::set(ENV_RELEASE));
+
+    simd::Float attackDone = simd::maskAnd(attack, simd::greaterEqual(value, simd::set(1)));
+    simd::Float decayDone = simd::maskAnd(decay, simd::lessEqual(value, sustain));
+    simd::Float releaseDone = simd::maskAnd(release, simd::lessEqual(value, simd::set(0)));
+
+    simd::Float inc = simd::add(simd::add(simd::mask(attack, attackInc), simd::mask(decay, decayInc)),
+                                simd::mask(release, releaseInc));
+    value = simd::add(value, inc);
+    value = simd::select(attackDone, simd::set(1), value);
+    value = simd::select(decayDone, sustain, value);
+    value = simd::select(releaseDone, simd::set(0), value);
+
+    stage = simd::add(stage, simd::mask(simd::maskOr(attackDone, decayDone), simd::set(1)));
+    stage = simd::select(releaseDone, simd::set(ENV_OFF), stage);
+
+    //the sustain stage follows the parameter
+    value = simd::select(simd::equal(stage, simd::set(ENV_SUSTAIN)), sustain, value);
+    return value;
+}
+
+/** Whether any lane is attacking, decaying or releasing. When none is, the
+    envelope is constant until a key is pressed or released, which only
+    happens between the calls of renderGroup */
+inline bool anyRamping(simd::Float stage) {
+    simd::Float attack = simd::equal(stage, simd::set(ENV_ATTACK));
+    simd::Float decay = simd::equal(stage, simd::set(ENV_DECAY));
+    simd::Float release = simd::equal(stage, simd::set(ENV_RELEASE));
+    return simd::any(simd::maskOr(simd::maskOr(attack, decay), release));
+}
+
+/** The constant value of an envelope that is not ramping, the sustain stage
+    follows the parameter like in envelopeStep */
+inline simd::Float holdLevel(simd::Float& value, simd::Float stage, simd::Float sustain) {
+    value = simd::select(simd::equal(stage, simd::set(ENV_SUSTAIN)), sustain, value);
+    return value;
+}
+
+//-----------------------------------------------------------------------------
+/** The sine of every lane with the given tier, only the polynomial is vectorized */
+template <SineQuality quality>
+inline simd::Float sineLanes(simd::Float x) {
+    if (quality == kSinePolynomial) {
+        return simd::sin(x);
+    }
+    float lanes[simd::WIDTH];
+    simd::store(lanes, x);
+    for (int32 i = 0; i < simd::WIDTH; i++) {
+        lanes[i] = quality == kSineTable ? tableSin(lanes[i]) : (float) std::sin((double) lanes[i]);
+    }
+    return simd::load(lanes);
+}
+
+//-----------------------------------------------------------------------------
+/** Adds the carriers of a group to the lanes of one oversampled sample, the
+    double lanes of the 64-bit buses take them widened */
+inline void accumulate(float* lanes, simd::Float sum) {
+    simd::store(lanes, simd::add(simd::load(lanes), sum));
+}
+
+inline void accumulate(double* lanes, simd::Float sum) {
+    float values[simd::WIDTH];
+    simd::store(values, sum);
+    for (int32 k = 0; k < simd::WIDTH; k++) {
+        lanes[k] += values[k];
+    }
+}
+
+/** Adds the lanes of another thread */
+inline void addLanes(float* lanes, const float* other, int32 count) {
+    for (int32 i = 0; i < count; i += simd::WIDTH) {
+        simd::store(lanes + i, simd::add(simd::load(lanes + i), simd::load(other + i)));
+    }
+}
+
+inline void addLanes(double* lanes, const double* other, int32 count) {
+    for (int32 i = 0; i < count; i++) {
+        lanes[i] += other[i];
+    }
+}
+
+/** The sum of the lanes of one sample */
+inline float sumLanes(const float* lanes) {
+    return simd::sum(simd::load(lanes));
+}
+
+inline double sumLanes(const double* lanes) {
+    double sum = 0;
+    for (int32 k = 0; k < simd::WIDTH; k++) {
+        sum += lanes[k];
+    }
+    return sum;
+}
+
+//-----------------------------------------------------------------------------
+/** Calls f(std::integral_constant<int32, n>()) for n = begin .. end - 1,
+    the loop is unrolled at compile time, so every n is a constant in f */
+template <int32 begin, int32 end, class F>
+inline typename std::enable_if<(begin >= end)>::type unroll(F&) {}
+
+template <int32 begin, int32 end, class F>
+inline typename std::enable_if<(begin < end)>::type unroll(F& f) {
+    f(std::integral_constant<int32, begin>());
+    unroll<begin + 1, end>(f);
+}
+
+//-----------------------------------------------------------------------------
+/** The lanes of one operator while a group of voices is rendered */
+struct OperatorLanes
+{
+    simd::Int phase;
+    simd::Int increment;
+    simd::Float env;
+    simd::Float stage;
+    simd::Float attack;
+    simd::Float decay;
+    simd::Float sustain;
+    simd::Float release;
+    simd::Float held;           //the level while no lane of the envelope ramps
+    simd::Float volume;
+    simd::Float feedback;
+    bool fed;                   //the feedback is not 0
+    simd::Float last;           //the last two outputs, for the feedback
+    simd::Float previous;
+    simd::Float amp;            //volume * envelope of the current sample
+    bool ramps;
+    const float* freq;          //the moving parameters, nullptr when settled
+    const float* gain;
+};
+
+} //namespace
+
+
+
+//-----------------------------------------------------------------------------
+FMVoiceBank::FMVoiceBank() {
+    sampleRate = 44100;
+    maxSamples = 0;
+    oversampling = 1;
+    doublePrecision = false;
+    renderingDoubles = false;
+    decimatorTail = 0;
+    pool = nullptr;
+    renderSamples = 0;
+    sineQuality = SYNTH_DEFAULT_SINE_QUALITY;
+
+    //the defaults of FMOperator
+    for (int32 op = 0; op < NUM_OPERATORS; op++) {
+        baseFreq[op].setValue(440);
+        baseFreq[op].setSmoothing(kSmoothLinear, DEFAULT_FREQUENCY_SMOOTHING);
+        volume[op].setValue(1);
+        volume[op].setSmoothing(kSmoothOnePole, DEFAULT_VOLUME_SMOOTHING);
+        frequencyRamp[op] = nullptr;
+        volumeRamp[op] = nullptr;
+        attackLevel[op] = 0.005;
+        decayLevel[op] = 0.005;
+        sustainLevel[op] = 1;
+        releaseLevel[op] = 0.005;
+        feedback[op] = 0;
+        setDecayIncrement(op);
+    }
+    algorithm = 0;
+    bend.setValue(1);
+    bend.setSmoothing(kSmoothLinear, DEFAULT_FREQUENCY_SMOOTHING);
+
+    for (int32 voice = 0; voice < MAX_POLYPHONY; voice++) {
+        keyMod[voice] = 1;
+        for (int32 op = 0; op < NUM_OPERATORS; op++) {
+            phase[op][voice] = 0;
+            envValue[op][voice] = 0;
+            envStage[op][voice] = ENV_OFF;
+            attackIncrement[op][voice] = 0;
+            releaseIncrement[op][voice] = 0;
+            lastOutput[op][voice] = 0;
+            previousOutput[op][voice] = 0;
+            setIncrement(op, voice);
+        }
+    }
+}
+
+//the increment advances the oscillators by one sample of the oversampled rate
+void FMVoiceBank::setIncrement(int32 op, int32 voice) {
+    double cycles = (double) keyMod[voice] * baseFreq[op].getValue() * bend.getValue() /
+                    (sampleRate * oversampling);
+    increment[op][voice] = cyclesToPhase(cycles);
+}
+
+//a stage of 0 seconds lasts one sample, like the stages shorter than one
+void FMVoiceBank::setDecayIncrement(int32 op) {
+    decayIncrement[op] = (sustainLevel[op] - 1) / std::max(decayLevel[op] * sampleRate, 1.0);
+}
+
+void FMVoiceBank::setSampleRate(Vst::SampleRate* _sampleRate) {
+    CVModule::setSampleRate(_sampleRate);
+    bend.setSampleRate(_sampleRate);
+    for (int32 op = 0; op < NUM_OPERATORS; op++) {
+        baseFreq[op].setSampleRate(_sampleRate);
+        volume[op].setSampleRate(_sampleRate);
+        setDecayIncrement(op);
+        for (int32 voice = 0; voice < MAX_POLYPHONY; voice++) {
+            setIncrement(op, voice);
+        }
+    }
+}
+
+void FMVoiceBank::setBlockSize(int32 _maxSamples) {
+    maxSamples = _maxSamples;
+    resizeLanes();
+    setupDecimators();
+    bend.setBlockSize(maxSamples);
+    bentFrequency.resize((size_t) NUM_OPERATORS * maxSamples);
+    for (int32 op = 0; op < NUM_OPERATORS; op++) {
+        baseFreq[op].setBlockSize(maxSamples);
+        volume[op].setBlockSize(maxSamples);
+    }
+}
+
+void FMVoiceBank::setWorkerPool(WorkerPool* _pool) {
+    pool = _pool;
+    resizeLanes();
+}
+
+void FMVoiceBank::setOversampling(int32 factor) {
+    oversampling = std::max(1, std::min(factor, Decimator<float>::MAX_FACTOR));
+    setupDecimators();
+    oversampling = mix32.decimator.getFactor();
+    resizeLanes();
+    for (int32 op = 0; op < NUM_OPERATORS; op++) {
+        for (int32 voice = 0; voice < MAX_POLYPHONY; voice++) {
+            setIncrement(op, voice);
+        }
+    }
+}
+
+void FMVoiceBank::setDoublePrecision(bool doubles) {
+    doublePrecision = doubles;
+    resizeLanes();
+    setupDecimators();
+}
+
+//the double mix is left empty for the 32-bit buses
+void FMVoiceBank::resizeLanes() {
+    int32 numThreads = pool ? pool->getNumThreads() : 1;
+    size_t numLanes = (size_t) numThreads * maxSamples * oversampling * simd::WIDTH;
+    size_t numOversampled = oversampling > 1 ? (size_t) maxSamples * oversampling : 0;
+    mix32.lanes.resize(numLanes);
+    mix32.oversampled.resize(numOversampled);
+    mix64.lanes.resize(doublePrecision ? numLanes : 0);
+    mix64.oversampled.resize(doublePrecision ? numOversampled : 0);
+}
+
+void FMVoiceBank::setupDecimators() {
+    mix32.decimator.setup(oversampling, maxSamples);
+    mix64.decimator.setup(doublePrecision ? oversampling : 1, doublePrecision ? maxSamples : 0);
+    decimatorTail = 0;
+}
+
+
+
+//-----------------------------------------------------------------------------
+//a voice is on while one of its carriers is, its level is the loudest carrier
+bool FMVoiceBank::isVoiceOn(int32 voice) {
+    for (int32 op = 0; op < FM_ALGORITHMS[algorithm].numOperators; op++) {
+        if (isCarrier(algorithm, op) && envStage[op][voice] != ENV_OFF) {
+            return true;
+        }
+    }
+    return false;
+}
+
+float FMVoiceBank::getVoiceLevel(int32 voice) {
+    float level = 0;
+    for (int32 op = 0; op < FM_ALGORITHMS[algorithm].numOperators; op++) {
+        if (isCarrier(algorithm, op)) {
+            level = std::max(level, envValue[op][voice]);
+        }
+    }
+    return level;
+}
+
+bool FMVoiceBank::isGroupOn(int32 first) {
+    for (int32 op = 0; op < FM_ALGORITHMS[algorithm].numOperators; op++) {
+        simd::Float stage = simd::load(&envStage[op][first]);
+        if (isCarrier(algorithm, op) && simd::any(simd::less(simd::set(ENV_OFF), stage))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FMVoiceBank::startVoice(int32 voice, int16* pitch) {
+    keyMod[voice] = pitchToCV(pitch);
+    for (int32 op = 0; op < NUM_OPERATORS; op++) {
+        setIncrement(op, voice);
+        envStage[op][voice] = ENV_ATTACK;
+        attackIncrement[op][voice] = (1 - envValue[op][voice]) / std::max(attackLevel[op] * sampleRate, 1.0);
+    }
+}
+
+void FMVoiceBank::releaseVoice(int32 voice) {
+    for (int32 op = 0; op < NUM_OPERATORS; op++) {
+        envStage[op][voice] = ENV_RELEASE;
+        releaseIncrement[op][voice] = -envValue[op][voice] / std::max(releaseLevel[op] * sampleRate, 1.0);
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+void FMVoiceBank::setOperatorVolume(int32 op, Vst::ParamValue* _volume) {
+    volume[op].setTarget(*_volume);
+}
+
+void FMVoiceBank::setOperatorFrequency(int32 op, Vst::ParamValue* freq) {
+    baseFreq[op].setTarget(*freq);
+    for (int32 voice = 0; voice < MAX_POLYPHONY; voice++) {
+        setIncrement(op, voice);
+    }
+}
+
+void FMVoiceBank::rampOperatorVolume(int32 op, Vst::ParamValue* _volume, int32 numSamples) {
+    volume[op].rampTo(*_volume, numSamples);
+}
+
+//while the frequency moves, the increments are updated at the end of every block
+void FMVoiceBank::rampOperatorFrequency(int32 op, Vst::ParamValue* freq, int32 numSamples) {
+    baseFreq[op].rampTo(*freq, numSamples);
+    for (int32 voice = 0; voice < MAX_POLYPHONY; voice++) {
+        setIncrement(op, voice);
+    }
+}
+
+void FMVoiceBank::setVolumeSmoothing(SmoothingMode mode, float seconds) {
+    for (int32 op = 0; op < NUM_OPERATORS; op++) {
+        volume[op].setSmoothing(mode, seconds);
+    }
+}
+
+void FMVoiceBank::setFrequencySmoothing(SmoothingMode mode, float seconds) {
+    for (int32 op = 0; op < NUM_OPERATORS; op++) {
+        baseFreq[op].setSmoothing(mode, seconds);
+    }
+    bend.setSmoothing(mode, seconds);
+}
+
+void FMVoiceBank::setOperatorAttack(int32 op, Vst::ParamValue* _value) {
+    attackLevel[op] = *_value;
+    for (int32 voice = 0; voice < MAX_POLYPHONY; voice++) {
+        if (envStage[op][voice] == ENV_ATTACK) {
+            attackIncrement[op][voice] = (1 - envValue[op][voice]) / std::max(attackLevel[op] * sampleRate, 1.0);
+        }
+    }
+}
+
+void FMVoiceBank::setOperatorDecay(int32 op, Vst::ParamValue* _value) {
+    decayLevel[op] = *_value;
+    setDecayIncrement(op);
+}
+
+void FMVoiceBank::setOperatorSustain(int32 op, Vst::ParamValue* _value) {
+    sustainLevel[op] = *_value;
+    setDecayIncrement(op);
+}
+
+void FMVoiceBank::setOperatorRelease(int32 op, Vst::ParamValue* _value) {
+    releaseLevel[op] = *_value;
+    for (int32 voice = 0; voice < MAX_POLYPHONY; voice++) {
+        if (envStage[op][voice] == ENV_RELEASE) {
+            releaseIncrement[op][voice] = -envValue[op][voice] / std::max(releaseLevel[op] * sampleRate, 1.0);
+        }
+    }
+}
+
+//the outputs are only kept while the feedback is on, it starts from silence
+void FMVoiceBank::setOperatorFeedback(int32 op, Vst::ParamValue* _value) {
+    if (feedback[op] == 0) {
+        std::fill(lastOutput[op], lastOutput[op] + MAX_POLYPHONY, 0.f);
+        std::fill(previousOutput[op], previousOutput[op] + MAX_POLYPHONY, 0.f);
+    }
+    feedback[op] = (float) (*_value * 0.5);
+}
+
+void FMVoiceBank::setAlgorithm(int32 index) {
+    algorithm = std::max(0, std::min(index, kNumFMAlgorithms - 1));
+}
+
+void FMVoiceBank::setSineQuality(SineQuality quality) { sineQuality = quality; }
+
+//like a frequency, while the bend moves the increments are updated at the end of every block
+void FMVoiceBank::rampPitchBend(Vst::ParamValue* ratio, int32 numSamples) {
+    bend.rampTo(*ratio, numSamples);
+    for (int32 op = 0; op < NUM_OPERATORS; op++) {
+        for (int32 voice = 0; voice < MAX_POLYPHONY; voice++) {
+            setIncrement(op, voice);
+        }
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Renders the voices first .. first + simd::WIDTH - 1 with the algorithm
+// `alg` and adds them to the lane buffer. For every operator, from the first:
+// out = volume * envelope * sin(phase + modulators + feedback * (last + previous) / 2)
+// where the modulators are the outputs of the operators before it that the
+// algorithm routes to it; the carriers are summed and scaled by the gain of
+// the algorithm. The operators, and the modulators of every operator, are
+// unrolled at compile time. The voices render in float, the lanes are double
+// for the 64-bit buses.
+// While a frequency is moving, the increments are computed every sample from
+// the ramp and the key of every lane.
+// Oversampled, the oscillators render `oversampling` samples per sample of
+// the envelopes and the parameters, which keep the output rate.
+//-----------------------------------------------------------------------------
+template <int32 alg, SineQuality quality, int32 factor, typename Sample>
+void FMVoiceBank::renderGroup(int32 first, int32 numSamples, Sample* lanes) {
+    const int32 numOperators = FM_ALGORITHMS[alg].numOperators;
+    const float gain = FM_ALGORITHMS[alg].gain;
+    OperatorLanes ops[numOperators];
+
+    auto load = [&](auto index) {
+        const int32 op = decltype(index)::value;
+        OperatorLanes& o = ops[op];
+        o.phase = simd::loadInt(&phase[op][first]);
+        o.increment = simd::loadInt(&increment[op][first]);
+        o.env = simd::load(&envValue[op][first]);
+        o.stage = simd::load(&envStage[op][first]);
+        o.attack = simd::load(&attackIncrement[op][first]);
+        o.decay = simd::set(decayIncrement[op]);
+        o.sustain = simd::set(sustainLevel[op]);
+        o.release = simd::load(&releaseIncrement[op][first]);
+        o.volume = simd::set(volume[op].getValue());
+        o.feedback = simd::set(feedback[op]);
+        o.fed = feedback[op] != 0;
+        o.last = simd::load(&lastOutput[op][first]);
+        o.previous = simd::load(&previousOutput[op][first]);
+        o.freq = frequencyRamp[op];
+        o.gain = volumeRamp[op];
+        //held chords are in the sustain stage, their envelopes are not stepped
+        o.ramps = anyRamping(o.stage);
+        o.held = holdLevel(o.env, o.stage, o.sustain);
+    };
+    unroll<0, numOperators>(load);
+
+    //the keys in periods per oversampled sample and Hz
+    const simd::Float keyScale = simd::mul(simd::load(&keyMod[first]),
+                                           simd::set(1.f / (float) (sampleRate * factor)));
+    int32 i = 0;
+
+    auto level = [&](auto index) {
+        OperatorLanes& o = ops[decltype(index)::value];
+        simd::Float env = o.ramps
+            ? envelopeStep(o.env, o.stage, o.attack, o.decay, o.sustain, o.release) : o.held;
+        if (o.gain) {
+            o.volume = simd::set(o.gain[i]);
+        }
+        o.amp = simd::mul(o.volume, env);
+    };
+
+    simd::Float out[numOperators];
+    simd::Float sum;
+    auto oscillate = [&](auto index) {
+        const int32 op = decltype(index)::value;
+        OperatorLanes& o = ops[op];
+        if (o.freq) {
+            o.phase = simd::add(o.phase, simd::cyclesToPhase(simd::mul(keyScale, simd::set(o.freq[i]))));
+        }
+        else {
+            o.phase = simd::add(o.phase, o.increment);
+        }
+        simd::Float x = simd::phaseToRadians(o.phase);
+        auto modulate = [&](auto m) {
+            if (modulates(alg, decltype(m)::value, op)) {
+                x = simd::add(x, out[decltype(m)::value]);
+            }
+        };
+        unroll<0, op>(modulate);
+        if (o.fed) {
+            //a dependency on the samples before, only taken with feedback
+            x = simd::mulAdd(o.feedback, simd::add(o.last, o.previous), x);
+        }
+
+        out[op] = simd::mul(o.amp, sineLanes<quality>(x));
+        if (o.fed) {
+            o.previous = o.last;
+            o.last = out[op];
+        }
+        if (isCarrier(alg, op)) {
+            sum = simd::add(sum, out[op]);
+        }
+    };
+
+    for (; i < numSamples; i++) {
+        unroll<0, numOperators>(level);
+        for (int32 k = 0; k < factor; k++) {
+            sum = simd::set(0);
+            unroll<0, numOperators>(oscillate);
+            if (gain != 1.f) {
+                sum = simd::mul(sum, simd::set(gain));
+            }
+            accumulate(lanes + (i * factor + k) * simd::WIDTH, sum);
+        }
+    }
+
+    auto store = [&](auto index) {
+        const int32 op = decltype(index)::value;
+        const OperatorLanes& o = ops[op];
+        simd::storeInt(&phase[op][first], o.phase);
+        simd::store(&envValue[op][first], o.env);
+        simd::store(&envStage[op][first], o.stage);
+        simd::store(&lastOutput[op][first], o.last);
+        simd::store(&previousOutput[op][first], o.previous);
+    };
+    unroll<0, numOperators>(store);
+}
+
+//one kernel per algorithm and oversampling factor, the table is built at compile time
+template <SineQuality quality, typename Sample, int32... algs>
+void FMVoiceBank::renderAlgorithm(int32 first, int32 numSamples, Sample* lanes,
+                                  std::integer_sequence<int32, algs...>) {
+    typedef void (FMVoiceBank::*GroupRenderer)(int32, int32, Sample*);
+    static const GroupRenderer KERNELS[][kNumFMAlgorithms] = {
+        { &FMVoiceBank::renderGroup<algs, quality, 1, Sample>... },
+        { &FMVoiceBank::renderGroup<algs, quality, 2, Sample>... },
+        { &FMVoiceBank::renderGroup<algs, quality, 4, Sample>... },
+        { &FMVoiceBank::renderGroup<algs, quality, 8, Sample>... },
+    };
+    int32 factor = oversampling == 8 ? 3 : oversampling == 4 ? 2 : oversampling == 2 ? 1 : 0;
+    (this->*KERNELS[factor][algorithm])(first, numSamples, lanes);
+}
+
+void FMVoiceBank::runTask(int32 task, int32 thread) {
+    if (renderingDoubles) {
+        renderTask<double>(task, thread);
+    }
+    else {
+        renderTask<float>(task, thread);
+    }
+}
+
+//every thread clears its lanes before its first group, so the lanes of a
+//thread that got no group are not read
+template <typename Sample>
+void FMVoiceBank::renderTask(int32 task, int32 thread) {
+    Sample* lanes = getMix((Sample*) nullptr).lanes.data() + (size_t) thread * maxSamples * oversampling * simd::WIDTH;
+    if (!threadUsed[thread]) {
+        std::fill(lanes, lanes + renderSamples * oversampling * simd::WIDTH, (Sample) 0);
+        threadUsed[thread] = 1;
+    }
+
+    const auto algorithms = std::make_integer_sequence<int32, kNumFMAlgorithms>();
+    switch (sineQuality)
+    {
+    case kSineTable:
+        renderAlgorithm<kSineTable>(activeGroups[task], renderSamples, lanes, algorithms);
+        break;
+    case kSineExact:
+        renderAlgorithm<kSineExact>(activeGroups[task], renderSamples, lanes, algorithms);
+        break;
+    default:
+        renderAlgorithm<kSinePolynomial>(activeGroups[task], renderSamples, lanes, algorithms);
+        break;
+    }
+}
+
+void FMVoiceBank::process(float* out, int32 numSamples) {
+    render(out, numSamples);
+}
+
+//without the double mix, see setDoublePrecision, the block is silent
+void FMVoiceBank::process(double* out, int32 numSamples) {
+    if (!doublePrecision) {
+        std::fill(out, out + numSamples, 0.);
+        return;
+    }
+    render(out, numSamples);
+}
+
+template <typename Sample>
+void FMVoiceBank::render(Sample* out, int32 numSamples) {
+    //the moving parameters are rendered once for all voices, the bend is
+    //multiplied into the frequencies here and not in the lanes of every group
+    const float* bendRamp = bend.isSettled() ? nullptr : bend.render(numSamples);
+    const float bendValue = bend.getValue();
+    bool frequencyMoved = bendRamp != nullptr;
+    for (int32 op = 0; op < NUM_OPERATORS; op++) {
+        frequencyRamp[op] = nullptr;
+        volumeRamp[op] = nullptr;
+        //the operators the algorithm does not use only follow their ramps
+        if (op >= FM_ALGORITHMS[algorithm].numOperators) {
+            if (!baseFreq[op].isSettled()) {
+                baseFreq[op].skip(numSamples);
+                frequencyMoved = true;
+            }
+            if (!volume[op].isSettled()) {
+                volume[op].skip(numSamples);
+            }
+            continue;
+        }
+        if (!baseFreq[op].isSettled()) {
+            frequencyRamp[op] = baseFreq[op].render(numSamples);
+            frequencyMoved = true;
+        }
+        if (bendRamp || (frequencyRamp[op] && bendValue != 1)) {
+            float* bent = bentFrequency.data() + (size_t) op * maxSamples;
+            for (int32 i = 0; i < numSamples; i++) {
+                float freq = frequencyRamp[op] ? frequencyRamp[op][i] : baseFreq[op].getValue();
+                bent[i] = freq * (bendRamp ? bendRamp[i] : bendValue);
+            }
+            frequencyRamp[op] = bent;
+        }
+        if (!volume[op].isSettled()) {
+            volumeRamp[op] = volume[op].render(numSamples);
+        }
+    }
+
+    int32 numActive = 0;
+    for (int32 first = 0; first < MAX_POLYPHONY; first += simd::WIDTH) {
+        if (isGroupOn(first)) {
+            activeGroups[numActive++] = first;
+        }
+    }
+
+    int32 numThreads = pool ? pool->getNumThreads() : 1;
+    std::fill(threadUsed, threadUsed + numThreads, 0);
+    renderSamples = numSamples;
+    renderingDoubles = std::is_same<Sample, double>::value;
+    if (pool) {
+        pool->run(this, numActive);
+    }
+    else {
+        for (int32 task = 0; task < numActive; task++) {
+            runTask(task, 0);
+        }
+    }
+
+    if (frequencyMoved) {
+        for (int32 op = 0; op < NUM_OPERATORS; op++) {
+            for (int32 voice = 0; voice < MAX_POLYPHONY; voice++) {
+                setIncrement(op, voice);
+            }
+        }
+    }
+
+    Mix<Sample>& mix = getMix(out);
+    if (numActive == 0) {
+        //the last voice ended at 0 at the input of the decimator, its output
+        //goes on until the filter has let out what it holds
+        if (decimatorTail > 0) {
+            std::fill(mix.oversampled.begin(), mix.oversampled.begin() + numSamples * oversampling, (Sample) 0);
+            mix.decimator.process(mix.oversampled.data(), out, numSamples);
+            decimatorTail -= std::min(decimatorTail, numSamples);
+            if (decimatorTail == 0) {
+                mix.decimator.reset();
+            }
+        }
+        else {
+            std::fill(out, out + numSamples, (Sample) 0);
+        }
+        return;
+    }
+    //the impulse response of the linear phase filter is twice its delay long
+    decimatorTail = oversampling > 1 ? (int32) std::ceil(2 * mix.decimator.getLatency()) : 0;
+
+    //with one thread the lanes are summed like before, the order of the
+    //additions and so the rounding only change when the groups are split
+    const int32 numRendered = numSamples * oversampling;
+    Sample* lanes = mix.lanes.data();
+    const size_t threadLanes = (size_t) maxSamples * oversampling * simd::WIDTH;
+    int32 first = 0;
+    while (!threadUsed[first]) {
+        first++;
+    }
+    lanes += first * threadLanes;
+    for (int32 t = first + 1; t < numThreads; t++) {
+        if (threadUsed[t]) {
+            addLanes(lanes, mix.lanes.data() + t * threadLanes, numRendered * simd::WIDTH);
+        }
+    }
+
+    Sample* mono = oversampling > 1 ? mix.oversampled.data() : out;
+    for (int32 i = 0; i < numRendered; i++) {
+        mono[i] = sumLanes(lanes + i * simd::WIDTH);
+    }
+    if (oversampling > 1) {
+        mix.decimator.process(mono, out, numSamples);
+    }
+}
+
+void FMVoiceBank::skip(int32 numSamples) {
+    bool frequencyMoved = !bend.isSettled();
+    if (frequencyMoved) {
+        bend.skip(numSamples);
+    }
+    for (int32 op = 0; op < NUM_OPERATORS; op++) {
+        if (!baseFreq[op].isSettled()) {
+            baseFreq[op].skip(numSamples);
+            frequencyMoved = true;
+        }
+        if (!volume[op].isSettled()) {
+            volume[op].skip(numSamples);
+        }
+    }
+    if (frequencyMoved) {
+        for (int32 op = 0; op < NUM_OPERATORS; op++) {
+            for (int32 voice = 0; voice < MAX_POLYPHONY; voice++) {
+                setIncrement(op, voice);
+            }
+        }
+    }
+}
+
+bool FMVoiceBank::isOn() {
+    return decimatorTail > 0 || PolyKeyboard::isOn();
+}
+
+float FMVoiceBank::output() {
+    float output;
+    process(&output, 1);
+    return output;
+}
+
+} //namespace Synth
+} //namespace Steinberg
@@ -0,0 +1,255 @@
+#include "../include/workerpool.h"
+#include "../include/realtime.h"
+
+#include <algorithm>
+#include <chrono>
+#include <system_error>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#define SYNTH_CPU_PAUSE() _mm_pause()
+#else
+#define SYNTH_CPU_PAUSE() ((void) 0)
+#endif
+
+namespace Steinberg {
+namespace Synth {
+
+namespace {
+
+//-----------------------------------------------------------------------------
+/** Waiting without a lock: a few hundred pauses, then yields,
+    then sleeps that double up to MAX_SLEEP */
+class Backoff
+{
+    static const int32 SPINS = 256;
+    static const int32 YIELDS = 64;
+    static const int32 MAX_SLEEP = 200;     //microseconds
+
+    int32 count;
+    int32 sleep;
+public:
+    Backoff() : count(0), sleep(10) {}
+
+    void reset() {
+        count = 0;
+        sleep = 10;
+    }
+
+    void pause() {
+        if (count < SPINS) {
+            SYNTH_CPU_PAUSE();
+        }
+        else if (count < SPINS + YIELDS) {
+            std::this_thread::yield();
+        }
+        else {
+            std::this_thread::sleep_for(std::chrono::microseconds(sleep));
+            sleep = std::min(2 * sleep, MAX_SLEEP);
+        }
+        count++;
+    }
+
+    //the audio thread never sleeps
+    void spin() {
+        SYNTH_CPU_PAUSE();
+    }
+};
+
+} //namespace
+
+
+
+//-----------------------------------------------------------------------------
+void WorkerPool::TaskDeque::reset(int32 capacity) {
+    int32 size = 1;
+    while (size < capacity) {
+        size *= 2;
+    }
+    tasks.assign(size, -1);
+    mask = size - 1;
+    top.store(0, std::memory_order_relaxed);
+    bottom.store(0, std::memory_order_relaxed);
+}
+
+void WorkerPool::TaskDeque::push(int32 task) {
+    int32 b = bottom.load(std::memory_order_relaxed);
+    tasks[b & mask] = task;
+    bottom.store(b + 1, std::memory_order_release);
+}
+
+int32 WorkerPool::TaskDeque::pop() {
+    int32 b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int32 t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return -1;
+    }
+    int32 task = tasks[b & mask];
+    if (t == b) {
+        //the last task, a thief may be taking it at the same time
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                         std::memory_order_relaxed)) {
+            task = -1;
+        }
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return task;
+}
+
+int32 WorkerPool::TaskDeque::steal() {
+    int32 t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int32 b = bottom.load(std::memory_order_acquire);
+
+    if (t >= b) {
+        return -1;
+    }
+    int32 task = tasks[t & mask];
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                     std::memory_order_relaxed)) {
+        return -1;
+    }
+    return task;
+}
+
+
+
+//-----------------------------------------------------------------------------
+WorkerPool::WorkerPool() {
+    numThreads = 1;
+    job = nullptr;
+    generation.store(0);
+    open.store(false);
+    remaining.store(0);
+    busyWorkers.store(0);
+    quit.store(false);
+}
+
+WorkerPool::~WorkerPool() { stop(); }
+
+bool WorkerPool::start(int32 numWorkers, int32 maxTasks) {
+    stop();
+
+    int32 hardware = (int32) std::thread::hardware_concurrency();
+    if (hardware > 0) {
+        numWorkers = std::min(numWorkers, hardware - 1);
+    }
+    numWorkers = std::max(0, std::min(numWorkers, MAX_THREADS - 1));
+
+    deques.reset(new TaskDeque[numWorkers + 1]);
+    for (int32 i = 0; i <= numWorkers; i++) {
+        deques[i].reset(std::max(maxTasks, 1));
+    }
+
+    //the threads read numThreads, it is final before the first one starts
+    numThreads = numWorkers + 1;
+    quit.store(false);
+    bool created = true;
+    for (int32 i = 1; i <= numWorkers; i++) {
+        try {
+            workers.push_back(std::thread(&WorkerPool::workerLoop, this, i));
+        }
+        catch (const std::system_error&) {
+            created = false;
+            break;
+        }
+    }
+    //the threads that were created steal from the deques of the missing ones
+    return created;
+}
+
+void WorkerPool::stop() {
+    quit.store(true);
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+    workers.clear();
+    numThreads = 1;
+}
+
+//-----------------------------------------------------------------------------
+int32 WorkerPool::findTask(int32 thread) {
+    int32 task = deques[thread].pop();
+    for (int32 i = 1; task < 0 && i < numThreads; i++) {
+        task = deques[(thread + i) % numThreads].steal();
+    }
+    return task;
+}
+
+void WorkerPool::work(int32 thread) {
+    AllocationGuard noAllocation;
+    Backoff backoff;
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        int32 task = findTask(thread);
+        if (task < 0) {
+            //the last tasks are running on other threads
+            backoff.spin();
+            continue;
+        }
+        job->runTask(task, thread);
+        remaining.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+//a worker joins a job only while it is open, run() closes it before it
+//waits for the workers to leave, so no worker is left in the deques
+//when the next job is pushed
+void WorkerPool::workerLoop(int32 thread) {
+    DenormalGuard denormals;    //the workers render like the audio thread
+    uint32 seen = generation.load(std::memory_order_acquire);
+    Backoff backoff;
+    while (!quit.load(std::memory_order_relaxed)) {
+        uint32 current = generation.load(std::memory_order_acquire);
+        if (current == seen) {
+            backoff.pause();
+            continue;
+        }
+        seen = current;
+        backoff.reset();
+
+        busyWorkers.fetch_add(1, std::memory_order_seq_cst);
+        if (open.load(std::memory_order_seq_cst) &&
+            generation.load(std::memory_order_acquire) == current) {
+            work(thread);
+        }
+        busyWorkers.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void WorkerPool::run(ParallelJob* _job, int32 numTasks) {
+    if (numThreads == 1 || numTasks <= 1) {
+        for (int32 task = 0; task < numTasks; task++) {
+            _job->runTask(task, 0);
+        }
+        return;
+    }
+
+    //no worker is inside a job here, the deques can be refilled
+    for (int32 i = 0; i < numThreads; i++) {
+        deques[i].top.store(0, std::memory_order_relaxed);
+        deques[i].bottom.store(0, std::memory_order_relaxed);
+    }
+    for (int32 task = 0; task < numTasks; task++) {
+        deques[task % numThreads].push(task);
+    }
+    //a worker may see the job open before it sees the new generation,
+    //opening it publishes the job as well
+    job = _job;
+    remaining.store(numTasks, std::memory_order_relaxed);
+    open.store(true, std::memory_order_seq_cst);
+    generation.fetch_add(1, std::memory_order_release);
+
+    work(0);
+
+    open.store(false, std::memory_order_seq_cst);
+    while (busyWorkers.load(std::memory_order_seq_cst) > 0) {
+        SYNTH_CPU_PAUSE();
+    }
+}
+
+} //namespace Synth
+} //namespace Steinberg
@@ -0,0 +1,237 @@
+#include "midifile.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace Steinberg {
+namespace Synth {
+
+namespace {
+
+const uint32 DEFAULT_TEMPO = 500000;        //microseconds per quarter note, 120 bpm
+
+struct TickEvent
+{
+    uint64 tick;
+    MidiEvent event;
+};
+
+struct TempoChange
+{
+    uint64 tick;
+    uint32 microsPerQuarter;
+};
+
+//-----------------------------------------------------------------------------
+/** Reads the big-endian numbers and the variable-length quantities of a
+    chunk, every read past the end sets `failed` */
+//-----------------------------------------------------------------------------
+class ByteReader
+{
+    const std::vector<uint8>& bytes;
+    size_t position;
+    size_t end;
+
+public:
+    bool failed;
+
+    ByteReader(const std::vector<uint8>& _bytes, size_t start, size_t _end)
+        : bytes(_bytes), position(start), end(std::min(_end, _bytes.size())), failed(false) {}
+
+    bool atEnd() { return position >= end; }
+
+    uint8 byte() {
+        if (position >= end) {
+            failed = true;
+            return 0;
+        }
+        return bytes[position++];
+    }
+
+    uint32 number(int32 numBytes) {
+        uint32 value = 0;
+        for (int32 i = 0; i < numBytes; i++) {
+            value = (value << 8) | byte();
+        }
+        return value;
+    }
+
+    uint32 variableLength() {
+        uint32 value = 0;
+        for (int32 i = 0; i < 4; i++) {
+            uint8 b = byte();
+            value = (value << 7) | (b & 0x7F);
+            if (!(b & 0x80)) {
+                return value;
+            }
+        }
+        failed = true;
+        return value;
+    }
+
+    void skip(uint32 numBytes) {
+        if (numBytes > end - position) {
+            failed = true;
+            position = end;
+            return;
+        }
+        position += numBytes;
+    }
+};
+
+//-----------------------------------------------------------------------------
+bool readTrack(ByteReader& reader, std::vector<TickEvent>& events, std::vector<TempoChange>& tempos) {
+    uint64 tick = 0;
+    uint8 runningStatus = 0;
+
+    while (!reader.atEnd() && !reader.failed) {
+        tick += reader.variableLength();
+        uint8 status = reader.byte();
+
+        if (status == 0xFF) {
+            //meta event, only the tempo and the end of the track matter
+            uint8 type = reader.byte();
+            uint32 length = reader.variableLength();
+            if (type == 0x51 && length == 3) {
+                tempos.push_back({ tick, reader.number(3) });
+            }
+            else if (type == 0x2F) {
+                return !reader.failed;
+            }
+            else {
+                reader.skip(length);
+            }
+            continue;
+        }
+        if (status == 0xF0 || status == 0xF7) {
+            //system exclusive
+            reader.skip(reader.variableLength());
+            continue;
+        }
+
+        uint8 data1;
+        if (status & 0x80) {
+            runningStatus = status;
+            data1 = reader.byte();
+        }
+        else {
+            //running status, the byte read is the first data byte
+            if (!runningStatus) {
+                return false;
+            }
+            data1 = status;
+            status = runningStatus;
+        }
+
+        //program change and channel pressure have one data byte
+        uint8 type = status & 0xF0;
+        uint8 data2 = (type == 0xC0 || type == 0xD0) ? 0 : reader.byte();
+        events.push_back({ tick, { 0, status, data1, data2 } });
+    }
+    return !reader.failed;
+}
+
+} //namespace
+
+
+
+//-----------------------------------------------------------------------------
+bool readMidiFile(const char* path, std::vector<MidiEvent>& events, std::string& error) {
+    FILE* file = std::fopen(path, "rb");
+    if (!file) {
+        error = std::string("cannot open ") + path;
+        return false;
+    }
+    std::vector<uint8> bytes;
+    uint8 buffer[4096];
+    size_t count;
+    while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        bytes.insert(bytes.end(), buffer, buffer + count);
+    }
+    std::fclose(file);
+
+    ByteReader header(bytes, 0, bytes.size());
+    uint32 headerId = header.number(4);
+    uint32 headerLength = header.number(4);
+    if (headerId != 0x4D546864 || headerLength < 6) {       //"MThd"
+        error = "not a Standard MIDI File";
+        return false;
+    }
+    uint32 format = header.number(2);
+    uint32 numTracks = header.number(2);
+    uint32 division = header.number(2);
+    if (header.failed || format > 1) {
+        error = "only MIDI files of format 0 and 1 are supported";
+        return false;
+    }
+    if (division & 0x8000) {
+        //SMPTE time: the frame rate is one of -24, -25, -29 and -30
+        int32 framesPerSecond = -(int8) (division >> 8);
+        bool knownRate = framesPerSecond == 24 || framesPerSecond == 25 ||
+                         framesPerSecond == 29 || framesPerSecond == 30;
+        if (!knownRate || (division & 0xFF) == 0) {
+            error = "the MIDI file has a malformed SMPTE time division";
+            return false;
+        }
+    } else if (division == 0) {
+        error = "the MIDI file has no time division";
+        return false;
+    }
+
+    std::vector<TickEvent> tickEvents;
+    std::vector<TempoChange> tempos;
+    size_t position = 8 + headerLength;
+    for (uint32 track = 0; track < numTracks && position + 8 <= bytes.size(); track++) {
+        ByteReader chunk(bytes, position, bytes.size());
+        uint32 id = chunk.number(4);
+        uint32 length = chunk.number(4);
+        position += 8;
+        if (id == 0x4D54726B) {     //"MTrk", other chunks are skipped
+            ByteReader reader(bytes, position, position + length);
+            if (!readTrack(reader, tickEvents, tempos)) {
+                error = "track " + std::to_string(track) + " is corrupted";
+                return false;
+            }
+        }
+        position += length;
+    }
+
+    //the events of all tracks are merged, the ones at the same tick keep their order
+    std::stable_sort(tickEvents.begin(), tickEvents.end(),
+                     [](const TickEvent& a, const TickEvent& b) { return a.tick < b.tick; });
+    std::stable_sort(tempos.begin(), tempos.end(),
+                     [](const TempoChange& a, const TempoChange& b) { return a.tick < b.tick; });
+
+    events.clear();
+    events.reserve(tickEvents.size());
+
+    if (division & 0x8000) {
+        //SMPTE time: frames per second and ticks per frame, the tempo does not apply
+        double framesPerSecond = -(int8) (division >> 8);
+        double secondsPerTick = 1 / (framesPerSecond * (division & 0xFF));
+        for (auto& e : tickEvents) {
+            e.event.seconds = e.tick * secondsPerTick;
+            events.push_back(e.event);
+        }
+        return true;
+    }
+
+    uint64 tempoTick = 0;
+    double tempoSeconds = 0;
+    double secondsPerTick = DEFAULT_TEMPO * 1e-6 / division;
+    size_t tempo = 0;
+    for (auto& e : tickEvents) {
+        while (tempo < tempos.size() && tempos[tempo].tick <= e.tick) {
+            tempoSeconds += (tempos[tempo].tick - tempoTick) * secondsPerTick;
+            tempoTick = tempos[tempo].tick;
+            secondsPerTick = tempos[tempo].microsPerQuarter * 1e-6 / division;
+            tempo++;
+        }
+        e.event.seconds = tempoSeconds + (e.tick - tempoTick) * secondsPerTick;
+        events.push_back(e.event);
+    }
+    return true;
+}
+
+} //namespace Synth
+} //namespace Steinberg
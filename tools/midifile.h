@@ -0,0 +1,34 @@
+#ifndef MIDI_FILE
+#define MIDI_FILE
+
+#include <pluginterfaces/base/ftypes.h>
+
+#include <string>
+#include <vector>
+
+namespace Steinberg {
+namespace Synth {
+
+//-----------------------------------------------------------------------------
+/** A channel message of a Standard MIDI File, with its time in seconds */
+//-----------------------------------------------------------------------------
+struct MidiEvent
+{
+    double seconds;
+    uint8 status;       //the message type in the high nibble, the channel in the low one
+    uint8 data1;
+    uint8 data2;
+};
+
+//-----------------------------------------------------------------------------
+/** Reads the channel messages of all tracks of a Standard MIDI File
+    (format 0 or 1) and sorts them by time, the tempo changes are applied
+    to convert the ticks to seconds.
+    Returns false and sets `error` if the file cannot be read. */
+//-----------------------------------------------------------------------------
+bool readMidiFile(const char* path, std::vector<MidiEvent>& events, std::string& error);
+
+} //namespace Synth
+} //namespace Steinberg
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef MOCK_HOST
+#define MOCK_HOST
+
+#include "pluginterfaces/vst/ivstevents.h"
+#include "pluginterfaces/vst/ivstparameterchanges.h"
+
+#include <vector>
+
+namespace Steinberg {
+namespace Synth {
+
+//-----------------------------------------------------------------------------
+// The objects a host passes to IAudioProcessor::process, for the tools that
+// run the processor without a host. They live on the stack of the tool, so
+// the reference counting does nothing.
+//-----------------------------------------------------------------------------
+#define MOCK_HOST_FUNKNOWN                                                      \
+    tresult PLUGIN_API queryInterface(const TUID /*_iid*/, void** obj) SMTG_OVERRIDE \
+    {                                                                           \
+        *obj = nullptr;                                                         \
+        return kNoInterface;                                                    \
+    }                                                                           \
+    uint32 PLUGIN_API addRef() SMTG_OVERRIDE { return 1; }                      \
+    uint32 PLUGIN_API release() SMTG_OVERRIDE { return 1; }
+
+//-----------------------------------------------------------------------------
+/** The events of one block, the capacity is reserved up front so that
+    adding events while rendering does not allocate */
+//-----------------------------------------------------------------------------
+class MockEventList : public Vst::IEventList
+{
+    std::vector<Vst::Event> events;
+
+public:
+    MockEventList(int32 capacity) { events.reserve(capacity); }
+
+    void clear() { events.clear(); }
+
+    int32 PLUGIN_API getEventCount() SMTG_OVERRIDE { return (int32) events.size(); }
+
+    tresult PLUGIN_API getEvent(int32 index, Vst::Event& e) SMTG_OVERRIDE {
+        if (index < 0 || index >= (int32) events.size()) {
+            return kInvalidArgument;
+        }
+        e = events[index];
+        return kResultTrue;
+    }
+
+    tresult PLUGIN_API addEvent(Vst::Event& e) SMTG_OVERRIDE {
+        if (events.size() == events.capacity()) {
+            return kOutOfMemory;
+        }
+        events.push_back(e);
+        return kResultTrue;
+    }
+
+    MOCK_HOST_FUNKNOWN
+};
+
+//-----------------------------------------------------------------------------
+/** The automation points of one parameter in one block */
+//-----------------------------------------------------------------------------
+class MockParamValueQueue : public Vst::IParamValueQueue
+{
+    struct Point
+    {
+        int32 sampleOffset;
+        Vst::ParamValue value;
+    };
+
+    Vst::ParamID id;
+    std::vector<Point> points;
+
+public:
+    MockParamValueQueue(Vst::ParamID _id, int32 capacity) : id(_id) { points.reserve(capacity); }
+
+    void clear() { points.clear(); }
+
+    Vst::ParamID PLUGIN_API getParameterId() SMTG_OVERRIDE { return id; }
+
+    int32 PLUGIN_API getPointCount() SMTG_OVERRIDE { return (int32) points.size(); }
+
+    tresult PLUGIN_API getPoint(int32 index, int32& sampleOffset, Vst::ParamValue& value) SMTG_OVERRIDE {
+        if (index < 0 || index >= (int32) points.size()) {
+            return kInvalidArgument;
+        }
+        sampleOffset = points[index].sampleOffset;
+        value = points[index].value;
+        return kResultTrue;
+    }
+
+    //the points have to be added in the order of their offsets
+    tresult PLUGIN_API addPoint(int32 sampleOffset, Vst::ParamValue value, int32& index) SMTG_OVERRIDE {
+        if (points.size() == points.capacity()) {
+            return kOutOfMemory;
+        }
+        index = (int32) points.size();
+        points.push_back({ sampleOffset, value });
+        return kResultTrue;
+    }
+
+    MOCK_HOST_FUNKNOWN
+};
+
+//-----------------------------------------------------------------------------
+/** The parameter changes of one block, one queue per parameter */
+//-----------------------------------------------------------------------------
+class MockParameterChanges : public Vst::IParameterChanges
+{
+    std::vector<MockParamValueQueue> queues;
+    int32 numUsed;
+    int32 pointsPerQueue;
+
+public:
+    MockParameterChanges(int32 maxParameters, int32 _pointsPerQueue)
+        : numUsed(0), pointsPerQueue(_pointsPerQueue) {
+        queues.reserve(maxParameters);
+    }
+
+    void clear() {
+        for (int32 i = 0; i < numUsed; i++) {
+            queues[i].clear();
+        }
+        numUsed = 0;
+    }
+
+    int32 PLUGIN_API getParameterCount() SMTG_OVERRIDE { return numUsed; }
+
+    Vst::IParamValueQueue* PLUGIN_API getParameterData(int32 index) SMTG_OVERRIDE {
+        return index >= 0 && index < numUsed ? &queues[index] : nullptr;
+    }
+
+    Vst::IParamValueQueue* PLUGIN_API addParameterData(const Vst::ParamID& id, int32& index) SMTG_OVERRIDE {
+        for (int32 i = 0; i < numUsed; i++) {
+            if (queues[i].getParameterId() == id) {
+                index = i;
+                return &queues[i];
+            }
+        }
+        //the queues are reused between blocks, a new one is only created for a new parameter
+        for (int32 i = numUsed; i < (int32) queues.size(); i++) {
+            if (queues[i].getParameterId() == id) {
+                std::swap(queues[i], queues[numUsed]);
+                index = numUsed++;
+                return &queues[index];
+            }
+        }
+        if (queues.size() == queues.capacity()) {
+            return nullptr;
+        }
+        queues.emplace_back(id, pointsPerQueue);
+        std::swap(queues.back(), queues[numUsed]);
+        index = numUsed++;
+        return &queues[index];
+    }
+
+    MOCK_HOST_FUNKNOWN
+};
+
+} //namespace Synth
+} //namespace Steinberg
+
+#endif
@@ -0,0 +1,429 @@
+//-----------------------------------------------------------------------------
+// Renders a Standard MIDI File with PlugProcessor, without a host or an
+// audio device, and reports how fast the rendering was.
+//
+//   SynthRender <input.mid> <output.wav> [options]
+//
+//   --preset <file>        normalized parameter values, one "<id> <value>" per line
+//   --rate <Hz>            sample rate, 48000 by default
+//   --block <samples>      samples per process call, 512 by default
+//   --tail <seconds>       rendered after the last MIDI event, 2 by default
+//   --block-times <file>   writes the time of every process call as CSV
+//   --double               64-bit buses and a 64-bit float WAV file
+//
+// See doc/offline-render.md
+//-----------------------------------------------------------------------------
+
+#include "../include/plugprocessor.h"
+#include "../include/plugids.h"
+#include "midifile.h"
+#include "mockhost.h"
+
+#include "pluginterfaces/base/funknown.h"
+#include "pluginterfaces/vst/ivstaudioprocessor.h"
+#include "pluginterfaces/vst/ivstcomponent.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace Steinberg;
+using namespace Steinberg::Synth;
+
+namespace {
+
+const int32 NUM_CHANNELS = 2;
+const int32 MAX_EVENTS_PER_BLOCK = 4096;
+const int32 MAX_PARAMETERS = 64;
+const int32 MAX_POINTS_PER_PARAMETER = 1024;
+
+struct Options
+{
+    const char* midiPath = nullptr;
+    const char* wavPath = nullptr;
+    const char* presetPath = nullptr;
+    const char* blockTimesPath = nullptr;
+    double sampleRate = 48000;
+    int32 blockSize = 512;
+    double tail = 2;
+    bool doublePrecision = false;
+};
+
+struct PresetValue
+{
+    Vst::ParamID id;
+    Vst::ParamValue value;
+};
+
+//-----------------------------------------------------------------------------
+bool parseOptions(int argc, char** argv, Options& options) {
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(arg, "--preset") == 0 && hasValue) {
+            options.presetPath = argv[++i];
+        }
+        else if (std::strcmp(arg, "--rate") == 0 && hasValue) {
+            options.sampleRate = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--block") == 0 && hasValue) {
+            options.blockSize = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--tail") == 0 && hasValue) {
+            options.tail = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--block-times") == 0 && hasValue) {
+            options.blockTimesPath = argv[++i];
+        }
+        else if (std::strcmp(arg, "--double") == 0) {
+            options.doublePrecision = true;
+        }
+        else if (arg[0] != '-' && positional == 0) {
+            options.midiPath = arg;
+            positional++;
+        }
+        else if (arg[0] != '-' && positional == 1) {
+            options.wavPath = arg;
+            positional++;
+        }
+        else {
+            return false;
+        }
+    }
+    return options.midiPath && options.wavPath && options.sampleRate > 0 && options.blockSize > 0
+        && options.tail >= 0;
+}
+
+//-----------------------------------------------------------------------------
+/** Reads "<id> <value>" lines, everything after a '#' is a comment */
+bool readPreset(const char* path, std::vector<PresetValue>& values) {
+    FILE* file = std::fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    char line[256];
+    bool ok = true;
+    while (std::fgets(line, sizeof(line), file)) {
+        char* comment = std::strchr(line, '#');
+        if (comment) {
+            *comment = 0;
+        }
+        unsigned int id;
+        double value;
+        int read = std::sscanf(line, "%u %lf", &id, &value);
+        if (read == 2 && value >= 0 && value <= 1) {
+            values.push_back({ (Vst::ParamID) id, value });
+        }
+        else if (read != EOF) {
+            ok = false;
+        }
+    }
+    std::fclose(file);
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+/** Writes a 32 or 64-bit float WAV file block by block, the sizes in the
+    header are filled in by finish() */
+class WavWriter
+{
+    FILE* file;
+    uint32 numFrames;
+    uint32 bytesPerSample;
+
+    void write16(uint32 value) {
+        uint8 bytes[2] = { (uint8) value, (uint8) (value >> 8) };
+        std::fwrite(bytes, 1, 2, file);
+    }
+    void write32(uint32 value) {
+        uint8 bytes[4] = { (uint8) value, (uint8) (value >> 8), (uint8) (value >> 16), (uint8) (value >> 24) };
+        std::fwrite(bytes, 1, 4, file);
+    }
+
+public:
+    WavWriter() : file(nullptr), numFrames(0), bytesPerSample(4) {}
+
+    bool open(const char* path, uint32 sampleRate, uint32 _bytesPerSample) {
+        bytesPerSample = _bytesPerSample;
+        file = std::fopen(path, "wb");
+        if (!file) {
+            return false;
+        }
+        std::fwrite("RIFF", 1, 4, file);
+        write32(0);
+        std::fwrite("WAVEfmt ", 1, 8, file);
+        write32(16);
+        write16(3);                                     //IEEE float
+        write16(NUM_CHANNELS);
+        write32(sampleRate);
+        write32(sampleRate * NUM_CHANNELS * bytesPerSample);
+        write16(NUM_CHANNELS * bytesPerSample);
+        write16(8 * bytesPerSample);
+        std::fwrite("data", 1, 4, file);
+        write32(0);
+        return true;
+    }
+
+    //SampleType has bytesPerSample bytes
+    template <typename SampleType>
+    void write(SampleType** channels, int32 numSamples, std::vector<SampleType>& interleaved) {
+        for (int32 i = 0; i < numSamples; i++) {
+            for (int32 c = 0; c < NUM_CHANNELS; c++) {
+                interleaved[i * NUM_CHANNELS + c] = channels[c][i];
+            }
+        }
+        //the samples are written in the byte order of the machine, which is
+        //little-endian on every platform the plug-in is built for
+        std::fwrite(interleaved.data(), sizeof(SampleType), numSamples * NUM_CHANNELS, file);
+        numFrames += numSamples;
+    }
+
+    bool finish() {
+        uint32 dataSize = numFrames * NUM_CHANNELS * bytesPerSample;
+        std::fseek(file, 4, SEEK_SET);
+        write32(36 + dataSize);
+        std::fseek(file, 40, SEEK_SET);
+        write32(dataSize);
+        return std::fclose(file) == 0;
+    }
+};
+
+//-----------------------------------------------------------------------------
+double percentile(std::vector<double> values, double fraction) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t index = std::min(values.size() - 1, (size_t) (fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+} //namespace
+
+
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "usage: SynthRender <input.mid> <output.wav> [--preset <file>] "
+                             "[--rate <Hz>] [--block <samples>] [--tail <seconds>] "
+                             "[--block-times <file.csv>] [--double]\n");
+        return 2;
+    }
+
+    std::vector<MidiEvent> midi;
+    std::string error;
+    if (!readMidiFile(options.midiPath, midi, error)) {
+        std::fprintf(stderr, "%s: %s\n", options.midiPath, error.c_str());
+        return 1;
+    }
+    std::vector<PresetValue> preset;
+    if (options.presetPath && !readPreset(options.presetPath, preset)) {
+        std::fprintf(stderr, "%s: cannot read the preset\n", options.presetPath);
+        return 1;
+    }
+
+    //---the processor, created like a host would do it------
+    FUnknown* instance = PlugProcessor::createInstance(nullptr);
+    FUnknownPtr<Vst::IComponent> component(instance);
+    FUnknownPtr<Vst::IAudioProcessor> processor(instance);
+    if (!component || !processor || component->initialize(nullptr) != kResultOk) {
+        std::fprintf(stderr, "cannot create the processor\n");
+        return 1;
+    }
+
+    int32 sampleSize = options.doublePrecision ? Vst::kSample64 : Vst::kSample32;
+    if (processor->canProcessSampleSize(sampleSize) != kResultTrue) {
+        std::fprintf(stderr, "the processor cannot process %d-bit samples\n",
+                     options.doublePrecision ? 64 : 32);
+        return 1;
+    }
+
+    Vst::ProcessSetup setup;
+    setup.processMode = Vst::kOffline;
+    setup.symbolicSampleSize = sampleSize;
+    setup.maxSamplesPerBlock = options.blockSize;
+    setup.sampleRate = options.sampleRate;
+    processor->setupProcessing(setup);
+    component->setActive(true);
+    processor->setProcessing(true);
+
+    //---the buffers, everything is allocated before rendering------
+    std::vector<float> left(options.blockSize);
+    std::vector<float> right(options.blockSize);
+    float* channels[NUM_CHANNELS] = { left.data(), right.data() };
+    std::vector<float> interleaved(options.blockSize * NUM_CHANNELS);
+
+    //the 64-bit buses, only with --double
+    size_t size64 = options.doublePrecision ? options.blockSize : 0;
+    std::vector<double> left64(size64);
+    std::vector<double> right64(size64);
+    double* channels64[NUM_CHANNELS] = { left64.data(), right64.data() };
+    std::vector<double> interleaved64(size64 * NUM_CHANNELS);
+
+    Vst::AudioBusBuffers output;
+    output.numChannels = NUM_CHANNELS;
+    output.silenceFlags = 0;
+    if (options.doublePrecision) {
+        output.channelBuffers64 = channels64;
+    }
+    else {
+        output.channelBuffers32 = channels;
+    }
+
+    MockEventList events(MAX_EVENTS_PER_BLOCK);
+    MockParameterChanges changes(MAX_PARAMETERS, MAX_POINTS_PER_PARAMETER);
+
+    Vst::ProcessData data;
+    data.processMode = Vst::kOffline;
+    data.symbolicSampleSize = sampleSize;
+    data.numInputs = 0;
+    data.numOutputs = 1;
+    data.outputs = &output;
+    data.inputEvents = &events;
+    data.inputParameterChanges = &changes;
+
+    double lastEvent = midi.empty() ? 0 : midi.back().seconds;
+    int64 totalSamples = (int64) std::ceil((lastEvent + options.tail) * options.sampleRate);
+    int64 numBlocks = (totalSamples + options.blockSize - 1) / options.blockSize;
+    std::vector<double> blockTimes(numBlocks);
+
+    WavWriter wav;
+    if (!wav.open(options.wavPath, (uint32) options.sampleRate, options.doublePrecision ? 8 : 4)) {
+        std::fprintf(stderr, "cannot write %s\n", options.wavPath);
+        return 1;
+    }
+
+    //---the rendering------
+    size_t next = 0;
+    double renderSeconds = 0;
+    int32 droppedEvents = 0;
+    for (int64 block = 0; block < numBlocks; block++) {
+        int64 start = block * options.blockSize;
+        int32 numSamples = (int32) std::min<int64>(options.blockSize, totalSamples - start);
+
+        events.clear();
+        changes.clear();
+        if (block == 0) {
+            for (auto& p : preset) {
+                int32 index;
+                Vst::IParamValueQueue* queue = changes.addParameterData(p.id, index);
+                if (queue) {
+                    queue->addPoint(0, p.value, index);
+                }
+            }
+        }
+
+        for (; next < midi.size(); next++) {
+            int64 sample = (int64) std::floor(midi[next].seconds * options.sampleRate);
+            if (sample >= start + numSamples) {
+                break;
+            }
+            uint8 type = midi[next].status & 0xF0;
+
+            //the pitch bend is a parameter, like a host maps it with IMidiMapping
+            if (type == 0xE0) {
+                int32 index;
+                Vst::IParamValueQueue* queue = changes.addParameterData(kParamPitchBendId, index);
+                Vst::ParamValue value = ((midi[next].data2 << 7) | midi[next].data1) / 16383.;
+                if (!queue || queue->addPoint((int32) (sample - start), value, index) != kResultTrue) {
+                    droppedEvents++;
+                }
+                continue;
+            }
+
+            bool noteOn = type == 0x90 && midi[next].data2 > 0;
+            bool noteOff = type == 0x80 || (type == 0x90 && midi[next].data2 == 0);
+            if (!noteOn && !noteOff) {
+                continue;
+            }
+
+            Vst::Event event = {};
+            event.busIndex = 0;
+            event.sampleOffset = (int32) (sample - start);
+            if (noteOn) {
+                event.type = Vst::Event::kNoteOnEvent;
+                event.noteOn.channel = midi[next].status & 0x0F;
+                event.noteOn.pitch = midi[next].data1;
+                event.noteOn.velocity = midi[next].data2 / 127.f;
+                event.noteOn.noteId = -1;
+            }
+            else {
+                event.type = Vst::Event::kNoteOffEvent;
+                event.noteOff.channel = midi[next].status & 0x0F;
+                event.noteOff.pitch = midi[next].data1;
+                event.noteOff.velocity = midi[next].data2 / 127.f;
+                event.noteOff.noteId = -1;
+            }
+            if (events.addEvent(event) != kResultTrue) {
+                droppedEvents++;
+            }
+        }
+
+        data.numSamples = numSamples;
+        auto before = std::chrono::steady_clock::now();
+        processor->process(data);
+        auto after = std::chrono::steady_clock::now();
+
+        blockTimes[block] = std::chrono::duration<double>(after - before).count();
+        renderSeconds += blockTimes[block];
+        if (options.doublePrecision) {
+            wav.write(channels64, numSamples, interleaved64);
+        }
+        else {
+            wav.write(channels, numSamples, interleaved);
+        }
+    }
+
+    processor->setProcessing(false);
+    component->setActive(false);
+    component->terminate();
+    instance->release();
+
+    if (!wav.finish()) {
+        std::fprintf(stderr, "cannot write %s\n", options.wavPath);
+        return 1;
+    }
+
+    //---the report------
+    double audioSeconds = totalSamples / options.sampleRate;
+    double budget = options.blockSize / options.sampleRate;
+    int64 overBudget = std::count_if(blockTimes.begin(), blockTimes.end(),
+                                     [budget](double t) { return t > budget; });
+    double maxTime = blockTimes.empty() ? 0 : *std::max_element(blockTimes.begin(), blockTimes.end());
+
+    std::printf("rendered %.2f s of audio (%lld blocks of %d samples at %.0f Hz) in %.3f s\n",
+                audioSeconds, (long long) numBlocks, options.blockSize, options.sampleRate, renderSeconds);
+    std::printf("real-time factor %.4f (%.1fx faster than real time)\n",
+                renderSeconds / audioSeconds, audioSeconds / renderSeconds);
+    std::printf("per block (us): mean %.1f, median %.1f, p99 %.1f, max %.1f, budget %.1f\n",
+                1e6 * renderSeconds / std::max<int64>(numBlocks, 1), 1e6 * percentile(blockTimes, 0.5),
+                1e6 * percentile(blockTimes, 0.99), 1e6 * maxTime, 1e6 * budget);
+    std::printf("blocks over budget: %lld\n", (long long) overBudget);
+    if (droppedEvents) {
+        std::printf("events dropped: %d (more than %d notes or %d pitch bends in a block)\n",
+                    droppedEvents, MAX_EVENTS_PER_BLOCK, MAX_POINTS_PER_PARAMETER);
+    }
+
+    if (options.blockTimesPath) {
+        FILE* file = std::fopen(options.blockTimesPath, "w");
+        if (!file) {
+            std::fprintf(stderr, "cannot write %s\n", options.blockTimesPath);
+            return 1;
+        }
+        std::fprintf(file, "block,samples,microseconds\n");
+        for (int64 block = 0; block < numBlocks; block++) {
+            int32 numSamples = (int32) std::min<int64>(options.blockSize, totalSamples - block * options.blockSize);
+            std::fprintf(file, "%lld,%d,%.3f\n", (long long) block, numSamples, 1e6 * blockTimes[block]);
+        }
+        std::fclose(file);
+    }
+    return 0;
+}